@@ -0,0 +1,125 @@
+#ifndef COMPARATOR_HPP
+#define COMPARATOR_HPP
+
+// STL headers
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace grader
+{
+  /**
+   * @brief Describes how output of program is checked, parsed from 'checker' attribute of 'output'
+   * element: "exact" (default), "tokens" or "float:EPS" (for example "float:1e-6").
+   */
+  struct checker_spec
+  {
+    enum class checker_kind : unsigned char
+    {
+      EXACT, TOKENS, FLOAT
+    };
+
+    checker_kind kind = checker_kind::EXACT;
+    double tolerance = 0; /**< Allowed absolute (or relative for numbers larger than 1) error for FLOAT. */
+
+    static checker_spec from_str(const std::string& checkerStr);
+  };
+
+  /**
+   * @brief Incrementally compares program output with expected output.
+   * @details Output is fed in chunks (pipe reads or mapped file regions) as it arrives.
+   * As soon as output can't match anymore feed returns false so program can be killed.
+   * Output longer than maximum length given by factory is treated as mismatch, so memory and
+   * time spent on program that floods output stays bounded. Expected output is always trimmed.
+   */
+  class output_comparator
+  {
+    std::size_t m_maxLen; /**< Maximum number of bytes program may write. */
+    std::size_t m_consumed; /**< Number of bytes fed so far. */
+  protected:
+    const char* m_expected;
+    std::size_t m_expectedLen;
+    bool m_failed;
+
+    virtual bool feed_chunk(const char* data, const char* end) = 0;
+  public:
+    static constexpr std::size_t DEFAULT_SLACK = 4096;
+
+    explicit output_comparator(const char* expected, std::size_t expectedLen, std::size_t maxLen);
+    virtual ~output_comparator() = default;
+
+    // API
+    bool feed(const char* data, std::size_t len);
+    virtual bool finish() = 0;
+    bool failed() const { return m_failed; }
+
+    static bool is_space(char c) { return ' ' == c || ('\t' <= c && c <= '\r'); }
+    static const char* skip_space(const char* begin, const char* end);
+    static const char* find_space(const char* begin, const char* end);
+  };
+
+  /**
+   * @brief Output must be equal to expected output, leading and trailing whitespace is ignored.
+   */
+  class exact_comparator : public output_comparator
+  {
+    std::size_t m_matched; /**< Number of bytes of expected output that matched so far. */
+    bool m_started; /**< Is leading whitespace of output skipped. */
+  protected:
+    bool feed_chunk(const char* data, const char* end) override;
+  public:
+    explicit exact_comparator(const char* expected, std::size_t expectedLen, std::size_t slack = DEFAULT_SLACK);
+    bool finish() override { return !m_failed && m_matched == m_expectedLen; }
+  };
+
+  /**
+   * @brief Output must have same whitespace separated tokens as expected output.
+   */
+  class token_comparator : public output_comparator
+  {
+    std::size_t m_matched; /**< Position in expected output. */
+    bool m_inToken; /**< Did last fed chunk end in the middle of token. */
+  protected:
+    bool feed_chunk(const char* data, const char* end) override;
+  public:
+    explicit token_comparator(const char* expected, std::size_t expectedLen, std::size_t maxLen);
+    bool finish() override;
+  };
+
+  /**
+   * @brief Like token_comparator, but tokens that are both numbers can differ up to tolerance.
+   * @details Token split between chunks is buffered, token longer than MAX_TOKEN_LENGTH isn't
+   * number anyone writes, so it's compared byte by byte with expected token instead.
+   */
+  class float_comparator : public output_comparator
+  {
+    static constexpr std::size_t MAX_TOKEN_LENGTH = 512;
+
+    double m_tolerance;
+    std::size_t m_matched; /**< Position in expected output. */
+    bool m_inToken; /**< Did last fed chunk end in the middle of token. */
+    bool m_exactToken; /**< Is current (overlong) token compared byte by byte (m_matched is position in it). */
+    std::string m_token; /**< Part of token that was split between chunks. */
+
+    bool compare_token(const char* token, std::size_t len);
+    bool start_exact_token();
+    bool match_exact(const char* begin, const char* end);
+    bool end_exact_token();
+  protected:
+    bool feed_chunk(const char* data, const char* end) override;
+  public:
+    explicit float_comparator(const char* expected, std::size_t expectedLen, std::size_t maxLen, double tolerance);
+    bool finish() override;
+  };
+
+  /**
+   * @brief Creates comparator for given checker. Token comparators allow output up to
+   * TOKEN_LENGTH_FACTOR times longer than expected output (plus slack), since whitespace and
+   * number formatting may legitimately differ.
+   */
+  constexpr std::size_t TOKEN_LENGTH_FACTOR = 4;
+  std::unique_ptr<output_comparator> make_comparator(const checker_spec& checker, const char* expected,
+                                                     std::size_t expectedLen, std::size_t slack);
+}
+
+#endif // COMPARATOR_HPP
@@ -0,0 +1,47 @@
+#ifndef COMPILE_CACHE_HPP
+#define COMPILE_CACHE_HPP
+
+// Project headers
+#include "file_cache.hpp"
+
+// STL headers
+#include <cstddef>
+#include <string>
+
+namespace grader
+{
+  /**
+   * @brief Content addressed cache of compiled executables shared by all grading workers.
+   * @details Executables are stored in COMPILE_CACHE_DIR under hash of source, its file name (compiled
+   * program can depend on it, e.g. Java class name), language, compiler identity (path, size and
+   * modification time of compiler binary) and compiler flags.
+   * Hit is hardlinked into task directory so compiler isn't started at all. Last write time
+   * of cached file is refreshed on every hit, so least recently used files are removed when
+   * cache grows over COMPILE_CACHE_SIZE bytes.
+   */
+  class compile_cache
+  {
+  public:
+    static const char* SHM_COUNTERS_NAME;
+    static constexpr std::size_t DEFAULT_SIZE = 1UL << 30; // 1GB
+  private:
+    file_cache m_files;
+
+    compile_cache();
+  public:
+    // Cache is configured once per process
+    static compile_cache& instance();
+
+    // API
+    bool enabled() const { return m_files.enabled(); }
+    std::string key(const std::string& language, const std::string& compiler, const std::string& flags,
+                    const char* fileName, const char* source, std::size_t sourceLen) const;
+    bool fetch(const std::string& key, const std::string& executablePath);
+    void store(const std::string& key, const std::string& executablePath);
+    const file_cache::counters& stats() const { return m_files.stats(); }
+  private:
+    static std::string compiler_identity(const std::string& compiler);
+  };
+}
+
+#endif // COMPILE_CACHE_HPP
@@ -60,8 +60,6 @@ namespace grader
     static const grader_info INVALID_GR_INFO;
     
     // Runtime parameters
-    static const std::string SHELL;
-    static const std::string SHELL_CMD_FLAG;
     static const std::string SHMEM_NAME;
     static const std::string SHMEM_SIZE;
     static const std::string BASE_DIR;
@@ -69,6 +67,27 @@ namespace grader
     static const std::string LOG_DIR;
     static const std::string LOG_FILE;
     static const std::string LOG_LEVEL;
+    static const std::string WORKERS;
+    static const std::string QUEUE_SIZE;
+    static const std::string MAX_TASKS;
+    static const std::string TASK_TTL;
+    static const std::string REAPER_INTERVAL_MS;
+    static const std::string TEST_THREADS;
+    static const std::string MAX_PARALLEL_TESTS;
+    static const std::string WALL_TIME_FACTOR;
+    static const std::string CGROUP_DIR;
+    static const std::string OUTPUT_SLACK;
+    static const std::string COMPILE_CACHE_DIR;
+    static const std::string COMPILE_CACHE_SIZE;
+    static const std::string LONG_POLL_MAX_MS;
+    static const std::string SUITE_DIR;
+    static const std::string GENERATOR_DIR;
+    static const std::string GENERATOR_CACHE_DIR;
+    static const std::string GENERATOR_CACHE_SIZE;
+    static const std::string GENERATOR_TIME_MS;
+    static const std::string RESULT_CACHE_DIR;
+    static const std::string RESULT_CACHE_SIZE;
+    static const std::string RESULT_CACHE_TTL;
   private:
     map_type m_conf;
     std::unordered_set<language> m_languages;
@@ -91,6 +110,7 @@ namespace grader
     // API
     map_type::const_iterator get(const std::string& key) const noexcept;
     map_type::const_iterator invalid() const noexcept { return m_conf.cend(); }
+    std::size_t get_number(const std::string& key, std::size_t defaultValue) const; // Default when missing, empty or invalid
     grader_info get_grader(const std::string& languageName) const noexcept;
     static const std::string& get_grader_name(const grader_info& grInfo) noexcept;
     static const std::string& get_lib_name(const grader_info& grInfo) noexcept;
@@ -0,0 +1,108 @@
+#ifndef EPOCH_MANAGER_HPP
+#define EPOCH_MANAGER_HPP
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// BOOST headers
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+
+namespace grader
+{
+  class task;
+
+  /**
+   * @brief Epoch based reclamation of deleted tasks, so lock-free readers never touch freed memory.
+   * @details Reader holds guard while it uses task it found (guard publishes global epoch in reader
+   * slot of its thread). Deleted task is first removed from task table, so nobody can find it
+   * anymore, and then retired with current epoch, which is then advanced. Task is destroyed once
+   * every active reader entered after it was retired and it isn't pinned (task::pin holds task
+   * during long operations like grading or streaming, so guards cover only lookups). Reader slots
+   * live in shared memory, one per thread, and pins are recorded in slot of thread that holds them;
+   * slot of process that died is taken back with its epoch and pins, so crashed reader doesn't stop
+   * reclamation. Readers that find all slots taken are counted in overflow slot of their process and
+   * nothing is reclaimed while any live process has such reader (count of dead process is dropped).
+   */
+  class epoch_manager
+  {
+  public:
+    // Types and constants
+    struct reader_slot
+    {
+      std::atomic<int> owner; /**< Pid of process whose thread uses slot (zero when slot is free). */
+      std::atomic<std::uint64_t> epoch; /**< Epoch in which reader entered (zero when it's outside). */
+      std::atomic<std::uint64_t> pins[4]; /**< Segment handles of tasks pinned by thread (zero when entry is free). */
+
+      reader_slot() : owner(0), epoch(0), pins{} {}
+    };
+    using pin_entry = std::atomic<std::uint64_t>;
+    struct overflow_slot
+    {
+      std::atomic<int> owner; /**< Pid of process whose threads didn't get reader slot (zero when slot is free). */
+      std::atomic<std::size_t> readers; /**< Active readers of owner without reader slot. */
+
+      overflow_slot() : owner(0), readers(0) {}
+    };
+    struct retired_task
+    {
+      std::uint64_t handle; /**< Segment handle of task. */
+      std::uint64_t epoch; /**< Epoch in which task was retired. */
+    };
+    using shm_retired_allocator = boost::interprocess::allocator<retired_task, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_retired_vector = boost::interprocess::vector<retired_task, shm_retired_allocator>;
+    using mutex_type = boost::interprocess::interprocess_mutex;
+
+    static const char* SHM_NAME;
+    static constexpr std::size_t READER_SLOTS = 1024;
+    static constexpr std::size_t OVERFLOW_SLOTS = 64;
+
+    // Marks scope in which found tasks are used (guards can be nested)
+    class guard
+    {
+    public:
+      guard();
+      ~guard();
+      guard(const guard&) = delete;
+      guard& operator=(const guard&) = delete;
+    };
+  private:
+    std::atomic<std::uint64_t> m_epoch; /**< Global epoch, advanced on every retire. */
+    reader_slot m_readers[READER_SLOTS];
+    overflow_slot m_overflow[OVERFLOW_SLOTS];
+    shm_retired_vector m_retired; /**< Tasks waiting for readers to leave (guarded by m_lock). */
+    mutex_type m_lock;
+  public:
+    epoch_manager();
+
+    // Manager lives in shared memory so it's neither copyable nor movable
+    epoch_manager(const epoch_manager&) = delete;
+    epoch_manager& operator=(const epoch_manager&) = delete;
+    epoch_manager(epoch_manager&&) = delete;
+    epoch_manager& operator=(epoch_manager&&) = delete;
+
+    // Shared memory entry point (finds or constructs manager)
+    static epoch_manager& instance();
+
+    // API
+    void retire(task* t);
+    std::size_t reclaim();
+    std::size_t retired();
+    pin_entry* pin(task* t); // Caller must hold guard, nullptr when its thread has no free pin entry
+    static void unpin(pin_entry* entry) { entry->store(0); }
+  private:
+    reader_slot* claim_slot();
+    overflow_slot* claim_overflow_slot();
+    bool overflow_readers();
+    void enter(reader_slot* slot);
+    void leave(reader_slot* slot);
+    std::uint64_t scan_readers(std::vector<std::uint64_t>& pinned);
+  };
+}
+
+#endif // EPOCH_MANAGER_HPP
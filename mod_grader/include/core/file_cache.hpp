@@ -0,0 +1,60 @@
+#ifndef FILE_CACHE_HPP
+#define FILE_CACHE_HPP
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace grader
+{
+  /**
+   * @brief Size bounded directory of cache entries shared by all grading workers.
+   * @details Entries are files named by key. New entry is written under temporary name by caller
+   * and committed with atomic rename, so other workers never see partial entry. Size of directory
+   * is kept as running total in shared memory, so directory is scanned only when total crosses
+   * limit (and once to learn size of entries left from previous run). Scan removes entries with
+   * oldest last write time first, callers refresh it with touch when entry is used. Cache is
+   * disabled when directory isn't configured.
+   */
+  class file_cache
+  {
+  public:
+    // Counters live in shared memory so they are summed over all workers
+    struct counters
+    {
+      std::atomic<unsigned long> hits;
+      std::atomic<unsigned long> misses;
+      std::atomic<unsigned long> evictions;
+      std::atomic<unsigned long> bytes; /**< Size of cache (overwritten entries are counted until next scan). */
+      std::atomic<bool> sized; /**< Was directory scanned at least once (until then bytes isn't known). */
+      std::atomic<int> evictor; /**< Pid of worker scanning directory right now (zero when nobody is). */
+
+      counters() : hits(0), misses(0), evictions(0), bytes(0), sized(false), evictor(0) {}
+    };
+  private:
+    std::string m_name;
+    std::string m_dir;
+    std::size_t m_maxSize;
+    counters* m_counters;
+  public:
+    // Name is used in log messages, directory and size are read from given configuration keys
+    file_cache(const std::string& name, const char* shmCountersName, const std::string& dirKey,
+               const std::string& sizeKey, std::size_t defaultSize);
+
+    // API
+    bool enabled() const { return !m_dir.empty(); }
+    std::string entry_path(const std::string& key) const { return m_dir + "/" + key; }
+    std::string tmp_path(const std::string& key) const;
+    bool commit(const std::string& key, bool written = true);
+    void touch(const std::string& key);
+    void remove(const std::string& key);
+    void hit() { m_counters->hits.fetch_add(1, std::memory_order_relaxed); }
+    void miss() { m_counters->misses.fetch_add(1, std::memory_order_relaxed); }
+    const counters& stats() const { return *m_counters; }
+  private:
+    void evict();
+  };
+}
+
+#endif // FILE_CACHE_HPP
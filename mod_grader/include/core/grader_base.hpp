@@ -6,32 +6,48 @@
 #include "object.hpp"
 #include "register_creators.hpp"
 #include "task.hpp"
+#include "process.hpp"
 
 // STL headers
 #include <string>
 #include <vector>
 
-// BOOST headers
-#include <boost/optional.hpp>
-
-// Poco headers
-#include <Poco/Process.h>
-
 namespace Poco
 {
   class Pipe;
-  class PipeInputStream;
 }
 
 namespace grader
 { 
+  // Outcome of single test, numeric values of FAILED and PASSED match old boolean results
+  enum class verdict : unsigned char { FAILED = 0, PASSED = 1, TIME_LIMIT, MEMORY_LIMIT };
+  
+  // Verdict of single test together with resources that test process used
+  struct test_report
+  {
+    verdict result = verdict::FAILED;
+    std::size_t wallTimeMS = 0;
+    std::size_t cpuTimeMS = 0;
+    std::size_t peakMemoryKB = 0; /**< Peak resident set size. */
+    int signal = 0; /**< Signal that terminated test process (zero if it exited normally). */
+  };
+  
   class grader_base: public dynamic::object
   {
+    // Everything that is specific for one test run: scratch directory and resource limits
+    struct test_env
+    {
+      std::string dir;
+      process_limits limits;
+    };
+    
     task* m_task;
     std::string m_dirPath;
     std::string m_executablePath;
     std::string m_sourcePath;
   public:
+    static constexpr std::size_t DEFAULT_WALL_TIME_FACTOR = 2;
+    
     // Grader is DefaultConstructible
     grader_base();
     
@@ -53,7 +69,7 @@ namespace grader
     
     // API
     virtual bool compile(std::string& compileErr) const;
-    virtual bool run_test(const test& t) const;
+    virtual test_report run_test(const test_view& t, std::size_t testNo) const;
     
     // Implementing object's virtual function so graders can be created from shared libraries in runtime
     virtual const char* name() const { std::string gr("grader_"); return (gr + language()).c_str(); }
@@ -68,10 +84,10 @@ namespace grader
     virtual const char* executable_extension() const { return ""; };
     
     // Different languages require different ways to start process (for example Java uses 'java StartMe.class')
-    virtual Poco::ProcessHandle start_executable_process(const std::string& executable, 
-                                                         const std::vector< std::string >& args, 
-                                                         const std::string& workingDir, Poco::Pipe* toExecutable, 
-                                                         Poco::Pipe* fromExecutable) const;
+    virtual process_handle start_executable_process(const std::string& executable, 
+                                                    const std::vector< std::string >& args, 
+                                                    const std::string& workingDir, Poco::Pipe* toExecutable, 
+                                                    Poco::Pipe* fromExecutable, const process_limits& limits) const;
     
   private:
     // Utilities
@@ -80,25 +96,31 @@ namespace grader
     std::string dir_path() const;
     std::string source_path() const;
     std::string executable_path() const;
-    void write_to_disk(const std::string& path, const std::string& content) const;
-    boost::optional<Poco::ProcessHandle> run_compile(std::string& flags, Poco::Pipe& errPipe) const;
+    std::string test_dir_path(std::size_t testNo) const;
+    process_limits test_limits(std::size_t testNo) const;
+    void write_to_disk(const std::string& path, const char* content, std::size_t contentLen) const;
+    bool run_compile(std::vector<std::string>& args, std::string& compileErr) const;
     
     // Run test cases
-    bool run_test_std_std(const grader::subtest& in, const grader::subtest& out, const std::string& executable, Poco::Pipe& toExecutable, Poco::Pipe& fromExecutable) const;
-    bool run_test_cmd_std(const subtest& in, const subtest& out, 
-                                   const std::string& executable, Poco::Pipe& fromExecutable) const;
-    bool run_test_file_std(const subtest& in, const subtest& out, 
-                                   const std::string& executable, Poco::Pipe& fromExecutable) const;
-    bool run_test_std_file(const subtest& in, const subtest& out, const std::string& executable, 
-                                   Poco::Pipe& toExecutable) const;
-    bool run_test_cmd_file(const subtest& in, const subtest& out, const std::string& executable) const;
+    test_report run_test_std_std(const grader::subtest_view& in, const grader::subtest_view& out, const std::string& executable, const test_env& env,
+                             Poco::Pipe& toExecutable, Poco::Pipe& fromExecutable) const;
+    test_report run_test_cmd_std(const subtest_view& in, const subtest_view& out, 
+                                   const std::string& executable, const test_env& env, Poco::Pipe& fromExecutable) const;
+    test_report run_test_file_std(const subtest_view& in, const subtest_view& out, 
+                                   const std::string& executable, const test_env& env, Poco::Pipe& fromExecutable) const;
+    test_report run_test_std_file(const subtest_view& in, const subtest_view& out, const std::string& executable, 
+                                   const test_env& env, Poco::Pipe& toExecutable) const;
+    test_report run_test_cmd_file(const subtest_view& in, const subtest_view& out, const std::string& executable, const test_env& env) const;
     
-    bool run_test_file_file(const subtest& in, const subtest& out, const std::string& executable) const;
+    test_report run_test_file_file(const subtest_view& in, const subtest_view& out, const std::string& executable, const test_env& env) const;
     
-    std::vector<std::string> create_file_input(const subtest& in) const;
+    std::vector<std::string> create_file_input(const subtest_view& in, const test_env& env) const;
     
-    bool evaluate_output_stdin(Poco::PipeInputStream& fromExecutableStream, const grader::subtest& out, const Poco::ProcessHandle& ph) const;
-    bool evaluate_output_file(const std::string& absolutePath, const subtest& out, const Poco::ProcessHandle& ph) const;
+    test_report evaluate_output_stdin(const char* input, std::size_t inputLen, Poco::Pipe* toExecutable,
+                                      Poco::Pipe& fromExecutable, const grader::subtest_view& out, process_handle& ph) const;
+    std::size_t output_slack() const;
+    test_report evaluate_output_file(const std::string& absolutePath, const subtest_view& out, process_handle& ph) const;
+    static test_report report_from_status(const process_status& status);
                                    
   };
 }
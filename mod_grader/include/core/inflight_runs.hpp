@@ -0,0 +1,76 @@
+#ifndef INFLIGHT_RUNS_HPP
+#define INFLIGHT_RUNS_HPP
+
+// Project headers
+#include "task.hpp"
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+// BOOST headers
+#include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+
+namespace grader
+{
+  /**
+   * @brief Registry of grading runs that didn't finish yet, keyed by fingerprint of submission.
+   * @details Task whose fingerprint (see task::fingerprint) matches run in registry doesn't get
+   * graded on its own, it's attached to that run as follower and gets every state of leader,
+   * final status included. Leader leaves registry before it reaches final state, so follower
+   * can't attach to run that already ended (and leader can't be destroyed while it's in registry).
+   * Task that bypasses result cache has other fingerprint, so it shares only runs that are really graded.
+   * Lock order is registry lock, then lock of leader, then lock of follower, then segment lock, nobody
+   * takes them in other order.
+   */
+  class inflight_runs
+  {
+  public:
+    // Types and constants
+    struct fingerprint
+    {
+      task::shm_fingerprint hash;
+
+      bool operator<(const fingerprint& oth) const { return std::strcmp(hash, oth.hash) < 0; }
+    };
+    struct run
+    {
+      task::shm_id leaderId;
+    };
+    using value_type = std::pair<const fingerprint, run>;
+    using shm_run_allocator = boost::interprocess::allocator<value_type, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_run_map = boost::interprocess::map<fingerprint, run, std::less<fingerprint>, shm_run_allocator>;
+    using mutex_type = boost::interprocess::interprocess_mutex;
+
+    static const char* SHM_NAME;
+  private:
+    shm_run_map m_runs; /**< Leader of every run that didn't finish yet. */
+    mutex_type m_lock; /**< Protects runs. */
+    std::atomic<unsigned long> m_followers; /**< Number of tasks that ever joined run (see GET /stats.grade). */
+  public:
+    inflight_runs();
+
+    // Registry lives in shared memory so it's neither copyable nor movable
+    inflight_runs(const inflight_runs&) = delete;
+    inflight_runs& operator=(const inflight_runs&) = delete;
+    inflight_runs(inflight_runs&&) = delete;
+    inflight_runs& operator=(inflight_runs&&) = delete;
+
+    // Shared memory entry point (finds or constructs registry)
+    static inflight_runs& instance();
+
+    // API (join returns true when task became follower, otherwise task leads new run)
+    bool join(task* newTask);
+    void leave(const char* hash, const char* leaderId);
+    std::size_t size();
+    unsigned long followers() const { return m_followers.load(); }
+  };
+}
+
+#endif // INFLIGHT_RUNS_HPP
@@ -0,0 +1,49 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+// Project headers
+#include "file_cache.hpp"
+#include "task.hpp"
+
+// STL headers
+#include <cstddef>
+#include <string>
+
+namespace grader
+{
+  /**
+   * @brief Cache of final statuses of graded submissions shared by all grading workers.
+   * @details Status is stored in RESULT_CACHE_DIR under hash of source, file name, tests document
+   * (it carries limits and language) and identity of grader library, so resubmitted source is
+   * answered without compiling and running tests. Test events of run are stored with status, so
+   * stream clients of task served from cache see them too. Only deterministic results are stored: compile
+   * errors and finished tasks without time or memory limit verdicts (those depend on machine load).
+   * Entries expire RESULT_CACHE_TTL seconds after they were stored and oldest entries are removed
+   * when cache grows over RESULT_CACHE_SIZE bytes. Single submission can bypass cache (see task::bypass_cache).
+   */
+  class result_cache
+  {
+  public:
+    static const char* SHM_COUNTERS_NAME;
+    static constexpr std::size_t DEFAULT_SIZE = 1UL << 28; // 256MB
+    static constexpr std::size_t DEFAULT_TTL_S = 24 * 60 * 60; // 1 day
+  private:
+    file_cache m_files;
+    std::size_t m_ttlS;
+
+    result_cache();
+  public:
+    // Cache is configured once per process
+    static result_cache& instance();
+
+    // API
+    bool enabled() const { return m_files.enabled(); }
+    std::string key(const std::string& language, const std::string& graderLib, const char* suiteHash,
+                    const char* fileName, const char* source, std::size_t sourceLen) const;
+    bool fetch(const std::string& key, task::state& finalState, std::string& status, std::string& events);
+    void store(const std::string& key, task::state finalState, const std::string& status, const std::string& events);
+    const file_cache::counters& stats() const { return m_files.stats(); }
+  };
+}
+
+#endif // RESULT_CACHE_HPP
@@ -1,6 +1,9 @@
 #ifndef SUBTEST_HPP
 #define SUBTEST_HPP
 
+// Project headers
+#include "comparator.hpp"
+
 // STL headers
 #include <string>
 #include <map>
@@ -12,6 +15,8 @@
 
 namespace grader
 {
+  class subtest_view;
+  
   class subtest
   {
   public:
@@ -33,9 +38,10 @@ namespace grader
     shm_string m_content; // Test content (if input test then input else expected result).
     subtest_i_o m_io; // Which type of I/O will be used for this test (see html/test_example.xml for more info).
     shm_path m_path; // Path as optional parameter (again see html/test_example.xml for more info).
+    checker_spec m_checker; // How output is compared with expected output (only for output tests).
     
   public:
-    explicit subtest(grader::subtest::subtest_type type, std::string& cont, grader::subtest::subtest_i_o IO, const std::string& path);
+    explicit subtest(grader::subtest::subtest_type type, const grader::subtest_view& view);
     
     // Subtest can be moved
     subtest(subtest&&);
@@ -46,11 +52,48 @@ namespace grader
     inline const shm_string& content() const { return m_content; }
     inline subtest_i_o io() const { return m_io; }
     inline const shm_path& path() const { return m_path; }
+    inline const checker_spec& checker() const { return m_checker; }
+    subtest_view view() const;
     
     static subtest_i_o io_from_str(const std::string& ioStr);
   };
   
   using test = std::pair<subtest, subtest>;
+  
+  // Read-only range of bytes, test data is passed around this way so it's never copied
+  class byte_span
+  {
+    const char* m_data;
+    std::size_t m_size;
+  public:
+    byte_span(const char* data = "", std::size_t size = 0) : m_data(data), m_size(size) {}
+    
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    std::string str() const { return std::string(m_data, m_size); }
+  };
+  
+  // Subtest as grader sees it, content points into shared memory or into mapped suite file (see suite_file)
+  class subtest_view
+  {
+    subtest::subtest_i_o m_io;
+    checker_spec m_checker;
+    byte_span m_content;
+    byte_span m_path;
+  public:
+    subtest_view(subtest::subtest_i_o IO = subtest::subtest_i_o::STD, const checker_spec& checker = checker_spec(),
+                 const byte_span& content = byte_span(), const byte_span& path = byte_span())
+    : m_io(IO), m_checker(checker), m_content(content), m_path(path) {}
+    
+    subtest::subtest_i_o io() const { return m_io; }
+    const checker_spec& checker() const { return m_checker; }
+    const byte_span& content() const { return m_content; }
+    const byte_span& path() const { return m_path; }
+  };
+  
+  using test_view = std::pair<subtest_view, subtest_view>;
 }
 
 #endif // SUBTEST_HPP
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef SUITE_FILE_HPP
+#define SUITE_FILE_HPP
+
+// Project headers
+#include "subtest.hpp"
+
+// STL headers
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// BOOST headers
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace grader
+{
+  /**
+   * @brief Compiled test suite on disk, mapped read-only by every process that runs its tests.
+   * @details File has header with limits and language, table of test entries and data section.
+   * Entry gives I/O mode, checker, offsets of content and path in data section and SHA-1 of
+   * content. Expected outputs are stored already trimmed and every string is followed by
+   * terminal zero. Test data is served from page cache as views, so size of suite isn't bounded
+   * by shared memory segment (shared memory keeps only path of file).
+   */
+  class suite_file
+  {
+  public:
+    // On disk format (native byte order, file is only used on machine that wrote it)
+    static const char MAGIC[8];
+    static constexpr std::uint32_t VERSION = 1;
+
+    struct header
+    {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t testCount;
+      std::uint64_t memoryBytes;
+      std::uint64_t timeMS;
+      std::uint64_t parallelism;
+      char language[16];
+    };
+
+    struct subtest_entry
+    {
+      std::uint64_t contentOffset;
+      std::uint64_t contentLen;
+      std::uint64_t pathOffset;
+      std::uint64_t pathLen;
+      double tolerance;
+      std::uint8_t io;
+      std::uint8_t checker;
+      std::uint8_t padding[6];
+      char hash[40]; /**< SHA-1 of content as hex string (not zero terminated). */
+    };
+
+    struct test_entry
+    {
+      subtest_entry in;
+      subtest_entry out;
+    };
+  private:
+    boost::iostreams::mapped_file_source m_file;
+    const header* m_header;
+    const test_entry* m_tests;
+  public:
+    // Files are opened through open (mapping is shared by all users in process)
+    explicit suite_file(const std::string& path);
+
+    // API
+    std::size_t size() const { return m_header->testCount; }
+    test_view test(std::size_t testNo) const;
+    byte_span content_hash(std::size_t testNo, subtest::subtest_type type) const;
+
+    // Static API
+    static bool write(const std::string& path, const std::vector<test_view>& tests, std::size_t memoryBytes,
+                      std::size_t timeMS, const std::string& language, std::size_t parallelism);
+    static std::shared_ptr<const suite_file> open(const std::string& path);
+  private:
+    bool valid() const;
+    bool valid_entry(const subtest_entry& entry) const;
+    subtest_view view(const subtest_entry& entry) const;
+  };
+}
+
+#endif // SUITE_FILE_HPP
@@ -2,97 +2,160 @@
 #define TASK_HPP
 
 // Project headers
+#include "epoch_manager.hpp"
 #include "subtest.hpp"
+#include "test_suite.hpp"
+#include "task_table.hpp"
 
 // STL headers
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
-#include <tuple>
 
 // BOOST headers
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/containers/vector.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
-
-// Forward declaration of boost::uuids::uuid class
-namespace boost
-{
-  namespace uuids
-  {
-    class uuid;
-  }
-}
+#include <boost/interprocess/sync/interprocess_condition.hpp>
 
 namespace grader
 {
+  class grader_base;
+  struct test_report;
+  
   class task
   {
   public:
     // Types and constants
-    using test = std::pair<subtest, subtest>;
-    using test_attributes = std::tuple<std::size_t, std::size_t, std::string>;
+    using test = test_suite::test;
     enum class state : unsigned char { INVALID, WAITING, COMPILING, COMPILE_ERROR, RUNNING, FINISHED };
-    static const test_attributes INVALID_TEST_ATTR;
+    static constexpr char EVENT_SEPARATOR = '\x1e'; // ASCII record separator
     
     // Boost types 
     using shm_char_allocator = boost::interprocess::allocator<char, boost::interprocess::managed_shared_memory::segment_manager>;
     using shm_subtest_allocator = boost::interprocess::allocator<subtest, boost::interprocess::managed_shared_memory::segment_manager>;
-    using shm_test_allocator = boost::interprocess::allocator<test, boost::interprocess::managed_shared_memory::segment_manager>;
     using shm_path = boost::interprocess::basic_string<char, std::char_traits<char>, shm_char_allocator>;
-    using shm_test_vector = boost::interprocess::vector<test, shm_test_allocator>;
-    using shm_uuid = char[37]; // example: 2af4e3b0-ace9-4c12-9de6-674ec4b04b1f (36 chars + terminal zero)
+    using shm_test_vector = test_suite::shm_test_vector;
+    using shm_id = char[task_table::ID_LENGTH + 1]; // example: 0000002a00000003c0ffee15deadbeef (see task_table)
+    using shm_fingerprint = char[41]; // SHA-1 as hex string (40 chars + terminal zero)
+    struct follower
+    {
+      shm_id id;
+    };
+    using shm_follower_allocator = boost::interprocess::allocator<follower, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_follower_vector = boost::interprocess::vector<follower, shm_follower_allocator>;
     using shm_string = boost::interprocess::basic_string<char, std::char_traits<char>, shm_char_allocator>;
     using mutex_type = boost::interprocess::interprocess_mutex;
+    using condition_type = boost::interprocess::interprocess_condition;
+    
+    // Finds task and keeps it in memory for lifetime of pin (task can still be destroyed, it's just
+    // freed after last pin is gone), used instead of epoch_manager::guard for long operations.
+    // Pin is recorded in reader slot of calling thread, thread without free entry keeps guard instead.
+    class pin
+    {
+      task* m_task;
+      epoch_manager::pin_entry* m_entry;
+      std::unique_ptr<epoch_manager::guard> m_guard;
+    public:
+      explicit pin(const char* id);
+      ~pin();
+      pin(const pin&) = delete;
+      pin& operator=(const pin&) = delete;
+      task* get() const { return m_task; }
+      task* operator->() const { return m_task; }
+      explicit operator bool() const { return nullptr != m_task; }
+    };
 
   private:
     
     // Fields
     shm_string m_fileName; /**< Name of submitted file. */
-    shm_string m_fileContent; /**< Source code from submitted file. */
-    shm_test_vector m_tests; /**< List of test that compiled source code should pass. */ 
-    shm_uuid m_id; /**< Unique identifier for this task. This is also name of this task in shared memory. */ 
-    std::size_t m_memoryBytes; /**< Maximum memory that should compiled source use when executing. */ 
-    std::size_t m_timeMS; /**< Maximum allowed time for execution of compiled source. */ 
-    state m_state; /**< This field is used for tracking current state of task (is task waiting in queue, or is it executing etc.).  */ 
-    shm_string m_status; /**< Status is JSON encoded message to be returned when status is queried from Web module. */
-    char m_language[16]; /**< Language in which source code is written. */ 
+    shm_string m_fileContent; /**< Source code from submitted file (released in final state). */
+    boost::interprocess::offset_ptr<test_suite> m_suite; /**< Tests, limits and language shared with other tasks graded against same tests (released in final state). */
+    shm_id m_id; /**< Unique identifier for this task. This is also handle of its slot in task_table. */
+    std::atomic<state> m_state; /**< This field is used for tracking current state of task (is task waiting in queue, or is it executing etc.), it's read without lock. */
+    shm_string m_status; /**< Final status as JSON, written once before final state is published and never changed after. */
+    shm_string m_events; /**< Append-only log of JSON events (states and test results) separated by EVENT_SEPARATOR. */
+    mutable mutex_type m_lock; /**< Serializes state changes with events and waiters (lives in shared memory so it's shared by module and daemon). */
+    mutable condition_type m_stateChanged; /**< Signaled on every state change so long polling clients wake up. */
+    mutable std::size_t m_waiters; /**< Number of clients blocked in wait_for_change (task can't be destroyed then). */
+    bool m_bypassCache; /**< Task is graded even if its result is cached (see result_cache). */
+    shm_fingerprint m_fingerprint; /**< Fingerprint of run this task leads in inflight_runs (empty when it doesn't lead one). */
+    shm_follower_vector m_followers; /**< Identical tasks that share this task's grading run (guarded by m_lock). */
+    std::atomic<int> m_owner; /**< Pid of worker process that grades this task (zero until grading starts). */
+    std::atomic<std::int64_t> m_finishedAt; /**< Time (seconds since epoch) when task reached final state, zero before that. */
   public:
     // Task must be created with factory function (see create_task method)
-    explicit task(const char* fileName, std::size_t fnLen, const char* fileContent, std::size_t fcLen, 
-                  grader::task::shm_test_vector&& tests, const boost::uuids::uuid& id, std::size_t memoryBytes,
-                  std::size_t timeMS, const std::string& language);
+    explicit task(const char* fileName, std::size_t fnLen, shm_string&& fileContent, test_suite* suite,
+                  const char* id);
+    ~task();
     
     // Task is not copyable
     task(const task&) = delete;
     task& operator=(const task&) = delete;
     
-    // Task is movable by default (all members are movable)
+    // Task is movable (suite reference moves with it)
     task(task&&);
     task& operator=(task&&);
     
     // Getters
     const char* file_name() const { return m_fileName.c_str(); }
     const char* file_content() const { return m_fileContent.c_str(); }
+    std::size_t file_content_size() const { return m_fileContent.size(); }
     const char* id() const { return m_id; }
+    std::size_t memory_bytes() const { return m_suite->memory_bytes(); }
+    std::size_t time_ms() const { return m_suite->time_ms(); }
+    const test_suite& suite() const { return *m_suite; }
+    int owner() const { return m_owner.load(); }
+    std::int64_t finished_at() const { return m_finishedAt.load(); }
     
     // API
-    const char* status() const; // Must be interprocess safe
+    const char* status() const; // Lock-free, valid while caller holds epoch_manager::guard or pin
     state get_state() const;
+    state wait_for_change(state seen, unsigned timeoutMS) const;
+    bool has_waiters() const;
+    bool read_events(std::size_t& offset, std::string& events, unsigned timeoutMS) const;
+    void claim(); // Makes calling worker owner of task, task of owner that dies is ended by task_reaper
     void run_all();
+    void bypass_cache() { m_bypassCache = true; }
+    void reject(); // Ends task that won't be graded (queue is full or its worker died) as invalid
+    
+    // Sharing of grading run between identical tasks (see inflight_runs)
+    std::string fingerprint() const;
+    bool add_follower(task* follower);
+    void lead(const char* fingerprint);
 
     // Static API
-    static task* create_task(const char* fileName, std::size_t fnLen, const char* fileContent, std::size_t fcLen,
-                             const char* testsContent, std::size_t testsCLen);
+    static bool is_terminal(state s) { return state::INVALID == s || state::COMPILE_ERROR == s || state::FINISHED == s; }
+    static task* create_task(const char* fileName, std::size_t fnLen, shm_string&& fileContent, test_suite* suite);
+    static task* find(const char* id) { return task_table::instance().find(id); }
+    static void destroy(task* t);
+    static void free_task(task* t); // Only for epoch_manager, once nobody can read task anymore
     static bool is_valid_task_name(const char* name);
   private:
-    static test_attributes parse_tests(const char* testsContent, std::size_t testsCLen, grader::task::shm_test_vector& tests);
     static void terminate_handler();
     
+    // Run tests on multiple threads, results are stored in test order (false when tests couldn't be loaded)
+    std::size_t parallelism() const;
+    bool run_tests(const grader_base& graderObj, std::vector<test_report>& testResults);
+    
     // Interprocess safe status modifier
     void set_state(state newState);
+    void publish_test_result(std::size_t testNo, const test_report& report);
+    void publish_events(const std::string& events); // Events go to followers too (leader's lock is taken before theirs)
+    void compact(); // Releases source, tests and followers once task reaches final state
+    
+    // Status of task in given state
+    const char* status_of(state s) const;
+    
+    // Helpers that expect m_lock to be held
+    void append_event(const char* json);
   };
 }
 
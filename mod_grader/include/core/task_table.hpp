@@ -0,0 +1,89 @@
+#ifndef TASK_TABLE_HPP
+#define TASK_TABLE_HPP
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// BOOST headers
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+
+namespace grader
+{
+  class task;
+
+  /**
+   * @brief Fixed capacity table of tasks in shared memory, task id is address of its slot.
+   * @details Public id is slot index, generation of slot and random nonce as 32 hex digits.
+   * Generation is odd while slot holds task and it's incremented when task is added and when it's
+   * removed, so id of removed task never finds task that took its slot. Nonce keeps ids unguessable
+   * (every nonce is drawn from getrandom(2)). Lookup doesn't take any lock: it checks
+   * generation and nonce of slot around reading task handle. Adding and removing tasks is guarded
+   * by table lock, which is never held while segment is locked.
+   */
+  class task_table
+  {
+  public:
+    // Types and constants
+    struct handle
+    {
+      std::uint32_t slot;
+      std::uint32_t generation;
+      std::uint64_t nonce;
+    };
+    struct slot
+    {
+      std::atomic<std::uint32_t> generation;
+      std::atomic<std::uint64_t> nonce;
+      std::atomic<std::uint64_t> task; /**< Segment handle of task (zero while task isn't published). */
+
+      slot() : generation(0), nonce(0), task(0) {}
+    };
+    using shm_index_allocator = boost::interprocess::allocator<std::uint32_t, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_index_vector = boost::interprocess::vector<std::uint32_t, shm_index_allocator>;
+    using mutex_type = boost::interprocess::interprocess_mutex;
+
+    static const char* SHM_NAME;
+    static constexpr std::size_t ID_LENGTH = 32;
+    static constexpr std::size_t DEFAULT_CAPACITY = 1UL << 16;
+  private:
+    boost::interprocess::offset_ptr<slot> m_slots; /**< Array of all slots (atomics can't be moved, so it never grows). */
+    std::size_t m_capacity; /**< Number of slots. */
+    shm_index_vector m_free; /**< Indices of free slots, used as stack (guarded by m_lock). */
+    mutex_type m_lock;
+  public:
+    explicit task_table(std::size_t capacity);
+
+    // Table lives in shared memory so it's neither copyable nor movable
+    task_table(const task_table&) = delete;
+    task_table& operator=(const task_table&) = delete;
+    task_table(task_table&&) = delete;
+    task_table& operator=(task_table&&) = delete;
+
+    // Shared memory entry point (finds or constructs table)
+    static task_table& instance();
+
+    // API (id buffers must have room for ID_LENGTH chars and terminal zero)
+    bool reserve(char* id);
+    void publish(const char* id, task* t);
+    bool release(const char* id);
+    task* find(const char* id) const;
+    void for_each(const std::function<void(const char* id, task* t)>& visit) const; // Lock-free like find
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t size();
+
+    // Static API
+    static bool parse(const char* id, handle& h);
+    static void format(const handle& h, char* id);
+  private:
+    const slot* slot_of(const char* id, handle& h) const;
+  };
+}
+
+#endif // TASK_TABLE_HPP
@@ -0,0 +1,56 @@
+#ifndef TEST_GENERATOR_HPP
+#define TEST_GENERATOR_HPP
+
+// Project headers
+#include "file_cache.hpp"
+
+// STL headers
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace grader
+{
+  /**
+   * @brief Produces test data on grader instead of shipping it in tests document.
+   * @details Generators and reference solutions are trusted executables installed in GENERATOR_DIR,
+   * tests document only names them (name can't contain '/', so nothing outside that directory is
+   * started). Generator is started with seed and extra arguments and its standard output is test
+   * input. Reference solution gets test input on standard input and its standard output is
+   * expected output. Output is stored in GENERATOR_CACHE_DIR under hash of executable content and
+   * of everything it got (seed and arguments, or input), so every test is produced only once even
+   * when generator is rebuilt with same content. Least recently used outputs are removed when cache
+   * grows over GENERATOR_CACHE_SIZE bytes. Programs run in their own scratch directory under BASE_DIR,
+   * so they can't touch cached outputs. Cache is disabled when directory isn't configured.
+   */
+  class test_generator
+  {
+  public:
+    static constexpr std::size_t DEFAULT_TIME_MS = 60000; // 1 minute
+    static constexpr std::size_t MAX_OUTPUT_SIZE = 1UL << 30; // 1GB
+    static constexpr std::size_t DEFAULT_SIZE = 1UL << 30; // 1GB
+    static const char* SHM_COUNTERS_NAME;
+  private:
+    std::string m_programDir;
+    std::string m_scratchDir;
+    file_cache m_files;
+    std::size_t m_timeMS;
+
+    test_generator();
+  public:
+    // Generator is configured once per process
+    static test_generator& instance();
+
+    // API (on success path of cached output is returned)
+    bool enabled() const { return !m_programDir.empty() && m_files.enabled(); }
+    bool generate(const std::string& generator, const std::string& seed, const std::string& args, std::string& outputPath);
+    bool solve(const std::string& solution, const char* input, std::size_t inputLen, std::string& outputPath);
+    bool program_hash(const std::string& program, std::string& hash) const;
+  private:
+    bool run(const std::string& program, const std::string& key, const std::vector<std::string>& args,
+             const char* input, std::size_t inputLen, std::string& outputPath);
+    std::string program_path(const std::string& program) const { return m_programDir + "/" + program; }
+  };
+}
+
+#endif // TEST_GENERATOR_HPP
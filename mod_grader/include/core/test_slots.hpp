@@ -0,0 +1,74 @@
+#ifndef TEST_SLOTS_HPP
+#define TEST_SLOTS_HPP
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+
+// BOOST headers
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+
+namespace grader
+{
+  /**
+   * @brief Limit on number of tests run at the same time by all workers together.
+   * @details TEST_THREADS limits threads of one task, but every worker runs its own task, so
+   * without global limit machine would run WORKERS * TEST_THREADS tests at once and tests would
+   * get wall time limit breaches only because they wait for CPU. Test holds slot while it runs,
+   * slot remembers pid of its process, so slot of worker that died is taken back.
+   * Capacity is MAX_PARALLEL_TESTS (number of cores when it isn't configured).
+   */
+  class test_slots
+  {
+  public:
+    // Types and constants
+    struct slot
+    {
+      std::atomic<int> owner; /**< Pid of process whose test uses slot (zero when slot is free). */
+
+      slot() : owner(0) {}
+    };
+    using mutex_type = boost::interprocess::interprocess_mutex;
+    using condition_type = boost::interprocess::interprocess_condition;
+
+    static const char* SHM_NAME;
+    static constexpr std::size_t MAX_SLOTS = 1024;
+    static constexpr unsigned DEAD_OWNER_CHECK_MS = 100;
+
+    // Holds slot for its lifetime (waits until slot is free)
+    class guard
+    {
+      slot* m_slot;
+    public:
+      guard();
+      ~guard();
+      guard(const guard&) = delete;
+      guard& operator=(const guard&) = delete;
+    };
+  private:
+    std::size_t m_capacity; /**< Number of slots that can be taken. */
+    slot m_slots[MAX_SLOTS];
+    mutex_type m_lock; /**< Serializes taking and freeing slots. */
+    condition_type m_freed; /**< Signaled whenever slot is freed. */
+  public:
+    explicit test_slots(std::size_t capacity);
+
+    // Slots live in shared memory so they are neither copyable nor movable
+    test_slots(const test_slots&) = delete;
+    test_slots& operator=(const test_slots&) = delete;
+    test_slots(test_slots&&) = delete;
+    test_slots& operator=(test_slots&&) = delete;
+
+    // Shared memory entry point (finds or constructs slots)
+    static test_slots& instance();
+
+    // API
+    std::size_t capacity() const { return m_capacity; }
+  private:
+    slot* acquire();
+    void release(slot* s);
+  };
+}
+
+#endif // TEST_SLOTS_HPP
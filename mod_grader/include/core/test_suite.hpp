@@ -0,0 +1,114 @@
+#ifndef TEST_SUITE_HPP
+#define TEST_SUITE_HPP
+
+// Project headers
+#include "subtest.hpp"
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// BOOST headers
+#include <boost/interprocess/containers/string.hpp>
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+
+namespace grader
+{
+  class suite_file;
+  
+  /**
+   * @brief Parsed tests document shared read-only by all tasks graded against it.
+   * @details Suite lives in shared memory under name SHM_NAME_PREFIX + SHA-1 of tests document,
+   * so same document is parsed and stored only once no matter how many submissions use it.
+   * Suite is reference counted: every task holds one reference and suite is destroyed when
+   * last one is released. Reference count is guarded by shared memory segment lock, so
+   * finding suite by hash and taking reference is atomic with respect to release.
+   * Suite can also be registered on its own (uploaded once and referenced by hash from later
+   * submissions), registry then holds one more reference until suite is unregistered.
+   * When SUITE_DIR is configured test data is compiled to file (see suite_file) and shared
+   * memory keeps only its path, otherwise tests are kept in shared memory.
+   * Input of type 'gen' is produced by generator program and output of type 'ref' by reference
+   * solution (see test_generator), so big tests don't have to be shipped in tests document.
+   * Hash of such suite covers content of those programs as well as tests document. Programs aren't
+   * run by process that creates suite (httpd child would block request on them), suite is created
+   * pending and keeps tests document until worker that grades its first task produces generated
+   * tests (see prepare). Suite whose tests couldn't be produced stays invalid until it's destroyed.
+   */
+  class test_suite
+  {
+  public:
+    // Types and constants
+    using test = std::pair<subtest, subtest>;
+    using shm_test_allocator = boost::interprocess::allocator<test, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_test_vector = boost::interprocess::vector<test, shm_test_allocator>;
+    using shm_char_allocator = boost::interprocess::allocator<char, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_string = boost::interprocess::basic_string<char, std::char_traits<char>, shm_char_allocator>;
+    using shm_hash = char[41]; // SHA-1 as hex string (40 chars + terminal zero)
+    enum class state : unsigned char { READY, PENDING, INVALID };
+    static const char* SHM_NAME_PREFIX;
+    static constexpr unsigned GENERATOR_CHECK_MS = 100;
+  private:
+    shm_test_vector m_tests; /**< List of tests that compiled source code should pass (empty when tests are in file). */
+    shm_string m_file; /**< Path of compiled suite file (empty when tests are in shared memory). */
+    std::size_t m_size; /**< Number of tests. */
+    std::size_t m_memoryBytes; /**< Maximum memory that compiled source may use when executing. */
+    std::size_t m_timeMS; /**< Maximum allowed time for execution of compiled source. */
+    std::size_t m_parallelism; /**< Maximum number of tests that can run at the same time (0 means use configuration). */
+    char m_language[16]; /**< Language in which source code is written. */
+    shm_hash m_hash; /**< Hash of tests document (and of programs producing its tests), suite is found by it. */
+    std::size_t m_refs; /**< Number of holders of this suite (guarded by segment lock). */
+    bool m_registered; /**< Registry holds reference to this suite (guarded by segment lock). */
+    shm_string m_document; /**< Tests document of pending suite (released once generated tests are produced). */
+    std::atomic<state> m_state; /**< Test data can be viewed only in READY state, it's read without lock. */
+    std::atomic<int> m_generator; /**< Pid of worker that produces generated tests (zero when nobody does). */
+  public:
+    explicit test_suite(shm_test_vector&& tests, const std::string& file, std::size_t size, std::size_t memoryBytes,
+                        std::size_t timeMS, const std::string& language, std::size_t parallelism, const std::string& hash,
+                        const std::string& document);
+
+    // Suite is shared through shared memory so it's neither copyable nor movable
+    test_suite(const test_suite&) = delete;
+    test_suite& operator=(const test_suite&) = delete;
+    test_suite(test_suite&&) = delete;
+    test_suite& operator=(test_suite&&) = delete;
+
+    // Getters
+    std::size_t size() const { return m_size; }
+    std::size_t memory_bytes() const { return m_memoryBytes; }
+    std::size_t time_ms() const { return m_timeMS; }
+    std::size_t parallelism() const { return m_parallelism; }
+    const char* language() const { return m_language; }
+    const char* hash() const { return m_hash; }
+    state get_state() const { return m_state.load(); }
+
+    // Produces generated tests of pending suite (waits when other worker does it), false when suite has no test data
+    bool prepare();
+    
+    // Views of all tests (suite must be prepared), mapping of suite file (if there is one) is kept alive by file
+    bool views(std::vector<test_view>& tests, std::shared_ptr<const suite_file>& file) const;
+    
+    // Static API (every returned suite is acquired and must be released by caller)
+    static test_suite* create(const char* testsContent, std::size_t testsCLen);
+    static test_suite* acquire(const char* hash);
+    static void acquire(test_suite* suite);
+    static void release(test_suite* suite);
+    static bool register_suite(test_suite* suite);
+    static bool unregister_suite(const char* hash);
+    static bool is_valid_hash(const char* hash);
+  private:
+    static std::string shm_name(const std::string& hash) { return SHM_NAME_PREFIX + hash; }
+    static std::string suite_dir();
+    static bool store_tests(const std::vector<test_view>& views, const std::string& hash, std::size_t memoryBytes,
+                            std::size_t timeMS, const std::string& language, std::size_t parallelism,
+                            shm_test_vector& tests, std::string& file);
+    static void destroy(test_suite* suite);
+  };
+}
+
+#endif // TEST_SUITE_HPP
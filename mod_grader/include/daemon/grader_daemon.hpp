@@ -0,0 +1,49 @@
+#ifndef GRADER_DAEMON_HPP
+#define GRADER_DAEMON_HPP
+
+// STL headers
+#include <cstddef>
+#include <vector>
+
+// Linux headers
+#include <sys/types.h>
+
+namespace grader
+{
+  /**
+   * @brief Pre-forked pool of grading processes.
+   * @details Master process forks fixed number of workers and keeps that number constant
+   * (worker that dies, for example because of plugin crash, is replaced). Each worker pulls
+   * task ids from job_queue and runs all tests for that task. Between checks of its workers
+   * master runs task_reaper. SIGTERM or SIGINT sent to master stops whole pool.
+   */
+  class grader_daemon
+  {
+    std::size_t m_workersCount;
+    std::vector<pid_t> m_workers;
+  public:
+    static constexpr unsigned POP_TIMEOUT_MS = 1000;
+    static constexpr unsigned SUPERVISE_POLL_MS = 100;
+
+    explicit grader_daemon(std::size_t workersCount);
+
+    // Daemon is not copyable nor movable
+    grader_daemon(const grader_daemon&) = delete;
+    grader_daemon& operator=(const grader_daemon&) = delete;
+    grader_daemon(grader_daemon&&) = delete;
+    grader_daemon& operator=(grader_daemon&&) = delete;
+
+    // API
+    int run();
+
+    // Number of workers from configuration (or number of cores if not configured)
+    static std::size_t configured_workers();
+  private:
+    pid_t spawn_worker();
+    void stop_workers();
+    static void worker_loop();
+    static void stop_handler(int);
+  };
+}
+
+#endif // GRADER_DAEMON_HPP
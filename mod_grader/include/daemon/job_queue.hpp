@@ -0,0 +1,68 @@
+#ifndef JOB_QUEUE_HPP
+#define JOB_QUEUE_HPP
+
+// Project headers
+#include "task.hpp"
+
+// STL headers
+#include <cstddef>
+
+// BOOST headers
+#include <boost/interprocess/containers/vector.hpp>
+#include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+
+namespace grader
+{
+  /**
+   * @brief Bounded FIFO of task ids that lives in shared memory.
+   * @details Web module pushes ids of freshly created tasks and grading daemon
+   * workers pop them (popped task is claimed by worker, see task::claim). Queue is
+   * constructed once (by whichever process comes first) with capacity read from
+   * QUEUE_SIZE configuration entry and never grows.
+   */
+  class job_queue
+  {
+  public:
+    // Types and constants
+    struct job
+    {
+      task::shm_id id;
+    };
+    using shm_job_allocator = boost::interprocess::allocator<job, boost::interprocess::managed_shared_memory::segment_manager>;
+    using shm_job_vector = boost::interprocess::vector<job, shm_job_allocator>;
+    using mutex_type = boost::interprocess::interprocess_mutex;
+    using condition_type = boost::interprocess::interprocess_condition;
+
+    static const char* SHM_NAME;
+    static constexpr std::size_t DEFAULT_CAPACITY = 1024;
+  private:
+    shm_job_vector m_jobs; /**< Ring buffer with fixed size (capacity of queue). */
+    std::size_t m_head; /**< Index of oldest job in ring buffer. */
+    std::size_t m_size; /**< Number of jobs currently in queue. */
+    mutex_type m_lock; /**< Protects all fields above. */
+    condition_type m_notEmpty; /**< Signaled when job is pushed so sleeping workers can wake up. */
+
+  public:
+    explicit job_queue(std::size_t capacity);
+
+    // Queue lives in shared memory so it's neither copyable nor movable
+    job_queue(const job_queue&) = delete;
+    job_queue& operator=(const job_queue&) = delete;
+    job_queue(job_queue&&) = delete;
+    job_queue& operator=(job_queue&&) = delete;
+
+    // Shared memory entry point (finds or constructs queue)
+    static job_queue& instance();
+
+    // API
+    bool try_push(const char* taskId);
+    bool pop(task::shm_id& taskId, unsigned timeoutMS);
+    std::size_t size();
+    std::size_t capacity() const { return m_jobs.size(); }
+  };
+}
+
+#endif // JOB_QUEUE_HPP
@@ -0,0 +1,52 @@
+#ifndef TASK_REAPER_HPP
+#define TASK_REAPER_HPP
+
+// STL headers
+#include <atomic>
+#include <cstddef>
+
+namespace grader
+{
+  /**
+   * @brief Periodic garbage collection of tasks nobody will ask for anymore.
+   * @details Run by master process of grading daemon every REAPER_INTERVAL_MS milliseconds.
+   * Finished task that wasn't deleted by client is destroyed TASK_TTL seconds after it reached
+   * final state (zero keeps tasks until they are deleted). Task that is being graded by worker
+   * process that died is ended as invalid (together with tasks that follow it), so it can be
+   * collected too. Counters of collected tasks live in shared memory and are reported together
+   * with segment occupancy (see GET /stats.grade).
+   */
+  class task_reaper
+  {
+  public:
+    // Counters live in shared memory so module can report them
+    struct counters
+    {
+      std::atomic<unsigned long> passes;
+      std::atomic<unsigned long> expired;
+      std::atomic<unsigned long> orphaned;
+
+      counters() : passes(0), expired(0), orphaned(0) {}
+    };
+
+    static const char* SHM_COUNTERS_NAME;
+    static constexpr std::size_t DEFAULT_TTL_S = 60 * 60; // 1 hour
+    static constexpr std::size_t DEFAULT_INTERVAL_MS = 1000;
+  private:
+    std::size_t m_ttlS;
+    std::size_t m_intervalMS;
+    counters* m_counters;
+
+    task_reaper();
+  public:
+    // Reaper is configured once per process
+    static task_reaper& instance();
+
+    // API
+    std::size_t interval_ms() const { return m_intervalMS; }
+    void reap();
+    const counters& stats() const { return *m_counters; }
+  };
+}
+
+#endif // TASK_REAPER_HPP
@@ -20,8 +20,9 @@ protected:
     virtual const char* compiler_filename_flag() const;
     virtual bool should_write_src_file() const;
     virtual bool is_interpreted() const;
-    virtual Poco::ProcessHandle start_executable_process(const std::string& executable, const std::vector< std::string >& args, 
-                                                         const std::string& workingDir, Poco::Pipe* toBinaries, Poco::Pipe* fromBinaries) const;
+    virtual grader::process_handle start_executable_process(const std::string& executable, const std::vector< std::string >& args, 
+                                                            const std::string& workingDir, Poco::Pipe* toBinaries, Poco::Pipe* fromBinaries,
+                                                            const grader::process_limits& limits) const;
 };
 
 REGISTER_DYNAMIC_ST(grader_py)
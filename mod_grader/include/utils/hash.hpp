@@ -0,0 +1,27 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+// STL headers
+#include <cstddef>
+#include <string>
+
+// BOOST headers
+#include <boost/uuid/detail/sha1.hpp>
+
+namespace grader
+{
+  /**
+   * @brief Incremental SHA-1 used for content addressed caches (not for security).
+   */
+  class sha1_hasher
+  {
+    boost::uuids::detail::sha1 m_sha1;
+  public:
+    // API
+    sha1_hasher& update(const void* data, std::size_t len);
+    sha1_hasher& update(const std::string& str);
+    std::string hex_digest();
+  };
+}
+
+#endif // HASH_HPP
@@ -0,0 +1,125 @@
+#ifndef PROCESS_HPP
+#define PROCESS_HPP
+
+// STL headers
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+// Linux headers
+#include <sys/types.h>
+#include <sys/resource.h>
+
+namespace Poco
+{
+  class Pipe;
+}
+
+namespace grader
+{
+  /**
+   * @brief Resource limits applied to launched process (zero means no limit).
+   * @details CPU time and address space are enforced with rlimits in child before exec.
+   * Wall time is enforced by parent when waiting for process. When cgroup directory is given
+   * (cgroup v2 with memory controller delegated to grader) process is moved there and memory.max
+   * is used instead of address space limit so breaches can be reported as memory limit exceeded.
+   * Without cgroup, failed allocation just makes process crash, so parent samples peak address
+   * space of process while it runs and process that crashed with peak near the limit is reported
+   * as memory limit exceeded (single allocation far beyond limit can't be told apart from crash).
+   */
+  struct process_limits
+  {
+    std::size_t memoryBytes = 0;
+    std::size_t cpuTimeMS = 0;
+    std::size_t wallTimeMS = 0;
+    std::string cgroupDir;
+  };
+
+  /**
+   * @brief Describes how process ended.
+   */
+  struct process_status
+  {
+    int exitCode = -1; /**< Exit code if process exited normally, otherwise -1. */
+    int signal = 0; /**< Signal that terminated process, zero if process exited normally. */
+    bool wallTimeExceeded = false;
+    bool cpuTimeExceeded = false;
+    bool memoryExceeded = false;
+    std::size_t wallTimeMS = 0; /**< Time from launch until process was reaped. */
+    std::size_t cpuTimeMS = 0; /**< User and system CPU time. */
+    std::size_t peakMemoryKB = 0; /**< Peak resident set size of process (see process_handle::reap). */
+    struct rusage usage = {}; /**< Resources used by process (filled by wait4). */
+
+    bool limit_exceeded() const { return wallTimeExceeded || cpuTimeExceeded || memoryExceeded; }
+    bool success() const { return 0 == signal && 0 == exitCode && !limit_exceeded(); }
+  };
+
+  class process_handle
+  {
+    using clock_type = std::chrono::steady_clock;
+
+    pid_t m_pid;
+    process_limits m_limits;
+    clock_type::time_point m_started;
+    bool m_reaped;
+    bool m_killed; /**< Process was killed by us, so it didn't crash on its own. */
+    clock_type::time_point m_nextSample; /**< When memory of process is sampled next (rarely with cgroup). */
+    std::size_t m_peakVirtualKB; /**< Largest address space of process seen in samples. */
+    std::size_t m_peakRssKB; /**< Largest peak resident set size of process seen in samples. */
+    std::size_t m_inheritedRssKB; /**< Peak resident set size of our process when child exec-ed. */
+    process_status m_status;
+  public:
+    using output_handler = std::function<bool(const char* data, std::size_t len)>;
+    static constexpr std::size_t IO_CHUNK_SIZE = 1U << 16; // 64KB, size of pipe buffer
+    static constexpr unsigned SAMPLE_INTERVAL_MS = 10;
+    static constexpr std::size_t MLE_NEAR_LIMIT_PERCENT = 90; // Crash with address space this close to limit is MLE
+
+    explicit process_handle(pid_t pid, const process_limits& limits, std::size_t inheritedRssKB);
+    ~process_handle();
+
+    // Handle owns child process so it can't be copied, only moved
+    process_handle(const process_handle&) = delete;
+    process_handle& operator=(const process_handle&) = delete;
+    process_handle(process_handle&& oth);
+    process_handle& operator=(process_handle&& oth);
+
+    // API
+    pid_t id() const { return m_pid; }
+    const process_limits& limits() const { return m_limits; }
+    const process_status& wait();
+    void kill();
+    bool communicate(Poco::Pipe* inPipe, const char* input, std::size_t inputLen,
+                     Poco::Pipe* outPipe, const output_handler& onOutput);
+
+    // Milliseconds left until wall time limit (-1 when there's no limit)
+    long remaining_ms() const;
+  private:
+    bool wait_for_exit();
+    int poll_timeout() const;
+    void sample_memory();
+    void reap();
+    void read_cgroup_events();
+    void classify_crash();
+  };
+
+  /**
+   * @brief Spawn executable with given arguments (no shell involved) and limits.
+   * @details Child is created with clone(CLONE_VM | CLONE_VFORK), so cost of spawning doesn't
+   * grow with size of grader process. Pipes that are nullptr are replaced with /dev/null in child.
+   * Throws std::system_error if child couldn't be created.
+   */
+  process_handle launch_process(const std::string& executable, const std::vector<std::string>& args,
+                                const std::string& workingDir, Poco::Pipe* inPipe, Poco::Pipe* outPipe,
+                                Poco::Pipe* errPipe, const process_limits& limits);
+
+  /**
+   * @brief Tells if process that owns shared memory slot or claim doesn't exist anymore.
+   * @details Zero pid means nobody, so it isn't dead. Process that died without being collected
+   * by its parent is zombie and still counts as alive.
+   */
+  bool is_dead(pid_t pid);
+}
+
+#endif // PROCESS_HPP
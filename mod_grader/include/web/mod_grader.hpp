@@ -17,6 +17,28 @@
   #define EXTERN_C
 #endif // EXTERN_C
 
+// Upper bound for 'wait' parameter of long polling GET when configuration doesn't give one
+constexpr unsigned long DEFAULT_LONG_POLL_MAX_MS = 30000;
+
+// Interval of keepalive comments in event stream (GET /<id>.grade?stream=1) while task has no new events
+constexpr unsigned SSE_KEEPALIVE_MS = 15000;
+
+// POST /status.grade with list of task ids in body returns statuses of all of them
+constexpr const char* BATCH_STATUS_NAME = "status";
+
+// GET /stats.grade returns occupancy of shared memory segment, task table and queue with cache and reaper counters
+constexpr const char* STATS_NAME = "stats";
+
+// POST /batch.grade with many source files and one tests document creates task for every source
+constexpr const char* BATCH_SUBMIT_NAME = "batch";
+
+// PUT /suite.grade with tests document as body registers suite and returns its hash, submissions
+// then send only sources with ?suite=<hash> and DELETE /suite.grade?suite=<hash> unregisters it
+constexpr const char* SUITE_NAME = "suite";
+
+// Name of multipart field that carries tests document
+constexpr const char* TESTS_FIELD_NAME = "xmlToUpload";
+
 /**********************
  * APACHE API SECTION *
  **********************/
@@ -42,6 +64,4 @@ module AP_MODULE_DECLARE_DATA grader_module =
   register_hooks
 };
 
-void avoid_zombie_handler(int);
-
 #endif // MOD_GRADER_H
\ No newline at end of file
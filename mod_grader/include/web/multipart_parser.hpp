@@ -0,0 +1,61 @@
+#ifndef MULTIPART_PARSER_HPP
+#define MULTIPART_PARSER_HPP
+
+// STL headers
+#include <cstddef>
+#include <string>
+
+namespace grader
+{
+  /**
+   * @brief Incremental multipart/form-data parser.
+   * @details Body is fed in chunks of any size (as they come from network) and content of every
+   * part is passed to handler as it's found, so parts are never buffered as a whole. Only small
+   * state is kept between chunks: headers of current part and tail of chunk that could be
+   * beginning of delimiter. Parts can come in any order and with any headers, part is identified
+   * by 'name' and 'filename' parameters of its Content-Disposition header.
+   * Parser doesn't depend on Apache so it can be fed from bucket brigade or from memory.
+   */
+  class multipart_parser
+  {
+  public:
+    // Receiver of parsed parts, returning false from any method stops parsing
+    class handler
+    {
+    public:
+      virtual ~handler() {}
+      virtual bool begin_part(const std::string& name, const std::string& fileName) = 0;
+      virtual bool part_data(const char* data, std::size_t len) = 0;
+      virtual bool end_part() = 0;
+    };
+
+    static constexpr std::size_t MAX_HEADERS_LENGTH = 8192;
+  private:
+    enum class state : unsigned char { PREAMBLE, AFTER_DELIMITER, HEADERS, CONTENT, DONE, ERROR };
+
+    std::string m_delimiter; /**< CRLF + "--" + boundary, every part ends with it. */
+    std::string m_pending; /**< Tail of last chunk that matches beginning of delimiter. */
+    std::string m_headers; /**< Headers of current part collected so far. */
+    handler& m_handler;
+    state m_state;
+  public:
+    // Boundary is expected with leading "--" (as it appears in body, see request_parser::get_boundary)
+    multipart_parser(const char* boundary, std::size_t boundaryLen, handler& h);
+
+    // API
+    bool feed(const char* data, std::size_t len);
+    bool finish() const { return state::DONE == m_state; }
+
+    // Finds value of parameter in header line (for example name="x" or filename="x")
+    static bool header_param(const char* begin, const char* end, const char* param, const char*& value, std::size_t& valueLen);
+  private:
+    const char* feed_content(const char* data, const char* end);
+    const char* feed_after_delimiter(const char* data, const char* end);
+    const char* feed_headers(const char* data, const char* end);
+    const char* end_of_part(const char* next);
+    bool content(const char* data, std::size_t len);
+    const char* fail();
+  };
+}
+
+#endif // MULTIPART_PARSER_HPP
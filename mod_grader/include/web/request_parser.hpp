@@ -23,9 +23,11 @@
 #ifndef REQUEST_PARSER_H
 #define REQUEST_PARSER_H
 
+// Project headers
+#include "multipart_parser.hpp"
+
 // STL headers
 #include <cstddef>
-#include <tuple>
 
 struct request_rec;
 
@@ -36,28 +38,24 @@ namespace grader
   public:
     // Types and constants
     using size_type = std::size_t;
-    using parsed_data = std::tuple<char*       /* file name */, 
-                                   std::size_t /* file name length */, 
-                                   char*       /* file content */,
-                                   std::size_t /* file content length */,
-                                   char*       /* tests */,
-                                   std::size_t /* tests length */
-                                   >;
-    static constexpr unsigned char FILE_NAME = 0;
-    static constexpr unsigned char FILE_NAME_LEN = 1;
-    static constexpr unsigned char FILE_CONTENT = 2;
-    static constexpr unsigned char FILE_CONTENT_LEN = 3;
-    static constexpr unsigned char TESTS_CONTENT = 4;
-    static constexpr unsigned char TESTS_CONTENT_LEN = 5;
-    
     static constexpr size_type MAX_BODY_LENGTH = (1U << 20) * 20; // 20MB
+    static constexpr size_type READ_CHUNK_SIZE = 1U << 16; // 64KB
   private:
     request_rec* m_r;
   public:
     explicit request_parser(request_rec* r);
     
-    int parse(grader::request_parser::parsed_data& toFill) const;
-  private:
+  /**
+    * @brief Parses multipart/form-data body while it's being received.
+    * @details Body is read from input filters bucket by bucket and every bucket is fed directly
+    * to multipart parser, so body is never copied into one buffer. Handler gets content of every
+    * part and decides where it goes. Function returns HTTP codes to indicate success and failure.
+    * 
+    * @param h Receiver of parsed parts.
+    * @return int
+    */
+    int parse(grader::multipart_parser::handler& h) const;
+    
   /**
     * @brief Reads whole body of request but not header.
     * @details Body content is put to rbuf and number of bytes in body is kept in size.
@@ -69,6 +67,7 @@ namespace grader
     * @return int
     */
     int read_body(char*& rbuf, std::size_t& rbufLen) const;
+  private:
 
   /**
     * @brief Gets boundary for POST request with multipart/form-data encoding.
@@ -0,0 +1,78 @@
+// Project headers
+#include "process.hpp"
+
+// STL headers
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Linux headers
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Measures latency of starting and reaping short process with different launchers:
+ *  - fork + exec (what Poco::Process::launch did for test executables)
+ *  - fork + exec of 'bash -c' (what compilation did)
+ *  - grader::launch_process (clone with CLONE_VM | CLONE_VFORK)
+ * Worker processes are large (loaded graders, shared memory, buffers), so benchmark first
+ * allocates and touches given number of megabytes, fork has to copy page tables for all of it.
+ *
+ * Usage: spawn_bench [megabytes=512] [iterations=200] [executable=/bin/true]
+ */
+
+namespace
+{
+  using clock_type = chrono::steady_clock;
+
+  void fork_exec(char* const argv[])
+  {
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+      execvp(argv[0], argv);
+      _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+  }
+
+  template <typename Launcher>
+  void measure(const char* name, size_t iterations, Launcher launch)
+  {
+    auto start = clock_type::now();
+    for (size_t i = 0; i < iterations; ++i)
+      launch();
+    auto totalUS = chrono::duration_cast<chrono::microseconds>(clock_type::now() - start).count();
+    cout << name << ": " << totalUS / static_cast<long>(iterations) << " us per process" << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 512;
+  size_t iterations = argc > 2 ? max(strtoul(argv[2], nullptr, 10), 1UL) : 200;
+  string executable = argc > 3 ? argv[3] : "/bin/true";
+
+  // Make process as large as grading worker
+  vector<char> ballast(megabytes << 20);
+  memset(ballast.data(), 1, ballast.size());
+  cout << "Process size: " << megabytes << " MB, iterations: " << iterations << ", executable: " << executable << endl;
+
+  string bash = "bash", cmdFlag = "-c";
+  char* directArgv[] = { const_cast<char*>(executable.c_str()), nullptr };
+  char* shellArgv[] = { const_cast<char*>(bash.c_str()), const_cast<char*>(cmdFlag.c_str()),
+                        const_cast<char*>(executable.c_str()), nullptr };
+
+  measure("fork + exec", iterations, [&]() { fork_exec(directArgv); });
+  measure("fork + exec bash -c", iterations, [&]() { fork_exec(shellArgv); });
+  measure("launch_process", iterations, [&]() {
+    grader::launch_process(executable, vector<string>{}, "", nullptr, nullptr, nullptr, grader::process_limits{}).wait();
+  });
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// Project headers
+#include "task.hpp"
+#include "test_suite.hpp"
+#include "configuration.hpp"
+
+// STL headers
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// BOOST headers
+#include <boost/interprocess/allocators/adaptive_pool.hpp>
+
+using namespace std;
+
+/*
+ * Measures throughput of creating and destroying tasks from many threads at once (every thread
+ * stands for one httpd child or grading worker, they all allocate from one segment):
+ *  - task sized block from segment manager next to source string (how tasks were allocated)
+ *  - task sized block from node pool next to source string (how tasks are allocated now)
+ *  - task::create_task + task::destroy of task with source of given size
+ * Benchmark uses segment from configuration, so don't run it next to daemon that grades.
+ *
+ * Usage: task_bench [threads=4] [iterations=100000] [source bytes=2048]
+ */
+
+namespace
+{
+  using clock_type = chrono::steady_clock;
+  using task_storage = aligned_storage<sizeof(grader::task), alignof(grader::task)>::type;
+  using shm_storage_pool = boost::interprocess::adaptive_pool<task_storage, boost::interprocess::managed_shared_memory::segment_manager>;
+
+  const char* BENCH_SUITE = "<test memory=\"67108864\" time=\"1000\" language=\"c\">"
+                            "<input type=\"std\">1</input><output type=\"std\">1</output></test>";
+
+  template <typename Operation>
+  void measure(const char* name, size_t threads, size_t iterations, Operation operation)
+  {
+    auto start = clock_type::now();
+    vector<thread> runners;
+    for (size_t i = 0; i < threads; ++i)
+      runners.emplace_back([&]() { for (size_t j = 0; j < iterations; ++j) operation(); });
+    for (auto& runner : runners)
+      runner.join();
+    auto totalUS = chrono::duration_cast<chrono::microseconds>(clock_type::now() - start).count();
+    cout << name << ": " << threads * iterations * 1000000 / static_cast<size_t>(max<long>(totalUS, 1))
+         << " tasks per second" << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  using grader::shm;
+  size_t threads = argc > 1 ? max(strtoul(argv[1], nullptr, 10), 1UL) : 4;
+  size_t iterations = argc > 2 ? max(strtoul(argv[2], nullptr, 10), 1UL) : 100000;
+  size_t sourceBytes = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2048;
+  cout << "Threads: " << threads << ", iterations: " << iterations << ", source: " << sourceBytes
+       << " bytes, task: " << sizeof(grader::task) << " bytes" << endl;
+
+  grader::test_suite* suite = grader::test_suite::create(BENCH_SUITE, strlen(BENCH_SUITE));
+  if (!suite)
+  {
+    cerr << "Couldn't create tests in shared memory." << endl;
+    return EXIT_FAILURE;
+  }
+  string source(sourceBytes, 'x');
+
+  measure("segment manager", threads, iterations, [&]() {
+    void* block = shm().allocate(sizeof(grader::task));
+    grader::task::shm_string content(source.c_str(), shm().get_segment_manager());
+    shm().deallocate(block);
+  });
+
+  // Allocator is never destroyed, same as pool allocator of task
+  auto pool = new shm_storage_pool(shm().get_segment_manager());
+  measure("node pool", threads, iterations, [&]() {
+    auto block = pool->allocate_one();
+    grader::task::shm_string content(source.c_str(), shm().get_segment_manager());
+    pool->deallocate_one(block);
+  });
+
+  measure("create_task + destroy", threads, iterations, [&]() {
+    grader::task::shm_string content(source.c_str(), shm().get_segment_manager());
+    auto newTask = grader::task::create_task("bench.c", 7, boost::move(content), suite);
+    if (newTask)
+      grader::task::destroy(newTask);
+  });
+
+  grader::test_suite::release(suite);
+  return EXIT_SUCCESS;
+}
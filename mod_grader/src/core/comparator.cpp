@@ -0,0 +1,322 @@
+// Project headers
+#include "comparator.hpp"
+#include "grader_log.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// SIMD headers
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+#ifdef __SSE2__
+  // Bit i of result is set if byte i of block is whitespace (' ' or '\t'..'\r')
+  inline unsigned space_mask(const char* block)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    __m128i isBlank = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+
+    // Unsigned (c - '\t') < 5 done with signed compare of values shifted by 0x80
+    __m128i shifted = _mm_xor_si128(_mm_sub_epi8(bytes, _mm_set1_epi8('\t')), _mm_set1_epi8(-128));
+    __m128i isControl = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 5));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(isBlank, isControl)));
+  }
+#endif
+
+  // Finds first character for which is_space is equal to wantSpace
+  template <bool wantSpace>
+  const char* find_class(const char* begin, const char* end)
+  {
+#ifdef __SSE2__
+    for (; end - begin >= 16; begin += 16)
+    {
+      unsigned mask = space_mask(begin);
+      if (!wantSpace)
+        mask = ~mask & 0xFFFF;
+      if (0 != mask)
+        return begin + __builtin_ctz(mask);
+    }
+#endif
+    return find_if(begin, end, [](char c) { return grader::output_comparator::is_space(c) == wantSpace; });
+  }
+
+  bool parse_number(const string& token, double& number)
+  {
+    char* parseEnd = nullptr;
+    number = strtod(token.c_str(), &parseEnd);
+    return !token.empty() && parseEnd == token.c_str() + token.size() && isfinite(number);
+  }
+}
+
+namespace grader
+{
+  constexpr size_t output_comparator::DEFAULT_SLACK;
+  constexpr size_t float_comparator::MAX_TOKEN_LENGTH;
+
+  checker_spec checker_spec::from_str(const string& checkerStr)
+  {
+    checker_spec checker;
+    if ("exact" == checkerStr)
+      return checker;
+    if ("tokens" == checkerStr)
+    {
+      checker.kind = checker_kind::TOKENS;
+      return checker;
+    }
+
+    const string floatPrefix = "float:";
+    if (0 == checkerStr.compare(0, floatPrefix.size(), floatPrefix))
+    {
+      char* parseEnd = nullptr;
+      const char* tolerance = checkerStr.c_str() + floatPrefix.size();
+      checker.tolerance = strtod(tolerance, &parseEnd);
+      if (parseEnd != tolerance && '\0' == *parseEnd && checker.tolerance >= 0)
+      {
+        checker.kind = checker_kind::FLOAT;
+        return checker;
+      }
+    }
+
+    LOG("Unknown checker specified. Possible values are: 'exact', 'tokens', 'float:EPS'. Given value: " + checkerStr, grader::ERROR);
+    return checker_spec();
+  }
+
+  output_comparator::output_comparator(const char* expected, size_t expectedLen, size_t maxLen)
+  : m_maxLen(maxLen), m_consumed(0), m_expected(expected), m_expectedLen(expectedLen), m_failed(false)
+  {
+  }
+
+  bool output_comparator::feed(const char* data, size_t len)
+  {
+    if (m_failed)
+      return false;
+
+    // Program wrote more than it possibly could for correct answer
+    m_consumed += len;
+    if (m_consumed > m_maxLen)
+    {
+      m_failed = true;
+      return false;
+    }
+
+    m_failed = !feed_chunk(data, data + len);
+    return !m_failed;
+  }
+
+  const char* output_comparator::skip_space(const char* begin, const char* end)
+  {
+    return find_class<false>(begin, end);
+  }
+
+  const char* output_comparator::find_space(const char* begin, const char* end)
+  {
+    return find_class<true>(begin, end);
+  }
+
+  exact_comparator::exact_comparator(const char* expected, size_t expectedLen, size_t slack)
+  : output_comparator(expected, expectedLen, expectedLen + slack), m_matched(0), m_started(false)
+  {
+  }
+
+  bool exact_comparator::feed_chunk(const char* data, const char* end)
+  {
+    // Skip leading whitespace of output
+    if (!m_started)
+    {
+      data = skip_space(data, end);
+      if (data == end)
+        return true;
+      m_started = true;
+    }
+
+    // Compare with rest of expected output
+    size_t toCompare = min(static_cast<size_t>(end - data), m_expectedLen - m_matched);
+    if (0 != memcmp(data, m_expected + m_matched, toCompare))
+      return false;
+    m_matched += toCompare;
+    data += toCompare;
+
+    // Everything after expected output must be trailing whitespace
+    return skip_space(data, end) == end;
+  }
+
+  token_comparator::token_comparator(const char* expected, size_t expectedLen, size_t maxLen)
+  : output_comparator(expected, expectedLen, maxLen), m_matched(0), m_inToken(false)
+  {
+  }
+
+  bool token_comparator::feed_chunk(const char* data, const char* end)
+  {
+    const char* expectedEnd = m_expected + m_expectedLen;
+    while (data != end)
+    {
+      if (!m_inToken)
+      {
+        data = skip_space(data, end);
+        if (data == end)
+          break;
+
+        // New token in output, so expected output must have one too (previous token ended on whitespace)
+        m_matched = skip_space(m_expected + m_matched, expectedEnd) - m_expected;
+        if (m_matched == m_expectedLen)
+          return false;
+        m_inToken = true;
+      }
+
+      // Compare part of token in this chunk with expected output
+      const char* tokenEnd = find_space(data, end);
+      size_t len = tokenEnd - data;
+      if (len > m_expectedLen - m_matched || 0 != memcmp(data, m_expected + m_matched, len))
+        return false;
+      m_matched += len;
+      data = tokenEnd;
+
+      // Token ended in output, it must end in expected output as well
+      if (data != end)
+      {
+        if (m_matched != m_expectedLen && !is_space(m_expected[m_matched]))
+          return false;
+        m_inToken = false;
+      }
+    }
+    return true;
+  }
+
+  bool token_comparator::finish()
+  {
+    // Expected output is trimmed, so all of it must be matched (last token included)
+    return !m_failed && m_matched == m_expectedLen;
+  }
+
+  float_comparator::float_comparator(const char* expected, size_t expectedLen, size_t maxLen, double tolerance)
+  : output_comparator(expected, expectedLen, maxLen), m_tolerance(tolerance), m_matched(0), m_inToken(false),
+    m_exactToken(false)
+  {
+  }
+
+  bool float_comparator::feed_chunk(const char* data, const char* end)
+  {
+    while (data != end)
+    {
+      if (!m_inToken)
+      {
+        data = skip_space(data, end);
+        if (data == end)
+          break;
+        m_inToken = true;
+      }
+
+      // Token continues in next chunk, keep its beginning (overlong token is compared byte by byte instead)
+      const char* tokenEnd = find_space(data, end);
+      if (tokenEnd == end)
+      {
+        if (!m_exactToken && m_token.size() + (end - data) > MAX_TOKEN_LENGTH)
+        {
+          if (!start_exact_token() || !match_exact(m_token.data(), m_token.data() + m_token.size()))
+            return false;
+          m_token.clear();
+        }
+        if (m_exactToken)
+          return match_exact(data, end);
+        m_token.append(data, end);
+        break;
+      }
+
+      // Whole token is in chunk, compare it in place
+      bool matched;
+      if (m_exactToken)
+        matched = match_exact(data, tokenEnd) && end_exact_token();
+      else if (m_token.empty())
+        matched = compare_token(data, tokenEnd - data);
+      else
+      {
+        m_token.append(data, tokenEnd);
+        matched = compare_token(m_token.data(), m_token.size());
+        m_token.clear();
+      }
+      if (!matched)
+        return false;
+      m_inToken = false;
+      data = tokenEnd;
+    }
+    return true;
+  }
+
+  bool float_comparator::finish()
+  {
+    if (m_failed)
+      return false;
+    if (m_inToken && !(m_exactToken ? end_exact_token() : compare_token(m_token.data(), m_token.size())))
+      return false;
+    return m_matched == m_expectedLen;
+  }
+
+  bool float_comparator::compare_token(const char* token, size_t len)
+  {
+    const char* expectedEnd = m_expected + m_expectedLen;
+    const char* expectedToken = skip_space(m_expected + m_matched, expectedEnd);
+    if (expectedToken == expectedEnd)
+      return false;
+    const char* expectedTokenEnd = find_space(expectedToken, expectedEnd);
+    m_matched = expectedTokenEnd - m_expected;
+
+    size_t expectedLen = expectedTokenEnd - expectedToken;
+    if (expectedLen == len && 0 == memcmp(token, expectedToken, len))
+      return true;
+
+    // Tokens differ, they are still equal if both are numbers close enough
+    double number, expectedNumber;
+    if (len > MAX_TOKEN_LENGTH || expectedLen > MAX_TOKEN_LENGTH ||
+        !parse_number(string(token, len), number) || !parse_number(string(expectedToken, expectedLen), expectedNumber))
+      return false;
+    return fabs(number - expectedNumber) <= m_tolerance * max(1.0, fabs(expectedNumber));
+  }
+
+  bool float_comparator::start_exact_token()
+  {
+    m_matched = skip_space(m_expected + m_matched, m_expected + m_expectedLen) - m_expected;
+    m_exactToken = true;
+    return m_matched != m_expectedLen;
+  }
+
+  bool float_comparator::match_exact(const char* begin, const char* end)
+  {
+    size_t len = end - begin;
+    if (len > m_expectedLen - m_matched || 0 != memcmp(begin, m_expected + m_matched, len))
+      return false;
+    m_matched += len;
+    return true;
+  }
+
+  bool float_comparator::end_exact_token()
+  {
+    // Token ended in output, it must end in expected output as well
+    m_exactToken = false;
+    return m_matched == m_expectedLen || is_space(m_expected[m_matched]);
+  }
+
+  unique_ptr<output_comparator> make_comparator(const checker_spec& checker, const char* expected,
+                                                size_t expectedLen, size_t slack)
+  {
+    switch (checker.kind)
+    {
+      case checker_spec::checker_kind::TOKENS:
+        return unique_ptr<output_comparator>(new token_comparator(expected, expectedLen,
+                                                                  TOKEN_LENGTH_FACTOR * expectedLen + slack));
+      case checker_spec::checker_kind::FLOAT:
+        return unique_ptr<output_comparator>(new float_comparator(expected, expectedLen,
+                                                                  TOKEN_LENGTH_FACTOR * expectedLen + slack,
+                                                                  checker.tolerance));
+      default:
+        return unique_ptr<output_comparator>(new exact_comparator(expected, expectedLen, slack));
+    }
+  }
+}
@@ -0,0 +1,106 @@
+// Project headers
+#include "compile_cache.hpp"
+#include "configuration.hpp"
+#include "hash.hpp"
+
+// STL headers
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+// BOOST headers
+#include <boost/filesystem.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace grader
+{
+  const char* compile_cache::SHM_COUNTERS_NAME = "grader_compile_cache_counters";
+
+  compile_cache::compile_cache()
+  : m_files("compile cache", SHM_COUNTERS_NAME, configuration::COMPILE_CACHE_DIR,
+            configuration::COMPILE_CACHE_SIZE, DEFAULT_SIZE)
+  {
+  }
+
+  compile_cache& compile_cache::instance()
+  {
+    static compile_cache cache;
+    return cache;
+  }
+
+  string compile_cache::key(const string& language, const string& compiler, const string& flags,
+                            const char* fileName, const char* source, size_t sourceLen) const
+  {
+    sha1_hasher hasher;
+    hasher.update(language).update(compiler_identity(compiler)).update(flags);
+    hasher.update(fileName, strlen(fileName) + 1);
+    hasher.update(&sourceLen, sizeof(sourceLen)).update(source, sourceLen);
+    return hasher.hex_digest();
+  }
+
+  bool compile_cache::fetch(const string& key, const string& executablePath)
+  {
+    auto entry = m_files.entry_path(key);
+    boost::system::error_code code;
+    fs::create_hard_link(entry, executablePath, code);
+
+    // Cache on other file system can't be linked, copy is still much faster than compilation
+    if (boost::system::errc::cross_device_link == code)
+      fs::copy_file(entry, executablePath, code);
+    if (boost::system::errc::success != code)
+    {
+      m_files.miss();
+      return false;
+    }
+
+    // Mark entry as recently used (linked copies in task directories stay valid when it's evicted)
+    m_files.touch(key);
+    m_files.hit();
+    return true;
+  }
+
+  void compile_cache::store(const string& key, const string& executablePath)
+  {
+    auto tmpEntry = m_files.tmp_path(key);
+    boost::system::error_code code;
+    fs::create_hard_link(executablePath, tmpEntry, code);
+    if (boost::system::errc::cross_device_link == code)
+      fs::copy_file(executablePath, tmpEntry, code);
+
+    // Cached executable is shared by later tasks, so nobody gets to modify it
+    if (boost::system::errc::success == code)
+      fs::permissions(tmpEntry, fs::remove_perms | fs::owner_write | fs::group_write | fs::others_write, code);
+    m_files.commit(key, boost::system::errc::success == code);
+  }
+
+  string compile_cache::compiler_identity(const string& compiler)
+  {
+    // Resolve compiler same way shell does, so upgraded compiler doesn't reuse old executables
+    fs::path compilerPath(compiler);
+    if (!compilerPath.has_parent_path())
+    {
+      const char* pathEnv = getenv("PATH");
+      stringstream dirs(pathEnv ? pathEnv : "");
+      string dir;
+      while (getline(dirs, dir, ':'))
+      {
+        boost::system::error_code code;
+        if (fs::is_regular_file(fs::path(dir) / compiler, code))
+        {
+          compilerPath = fs::path(dir) / compiler;
+          break;
+        }
+      }
+    }
+
+    boost::system::error_code code;
+    auto resolved = fs::canonical(compilerPath, code);
+    if (code)
+      return compiler;
+    stringstream identity;
+    identity << resolved.string() << ':' << fs::file_size(resolved, code) << ':' << fs::last_write_time(resolved, code);
+    return identity.str();
+  }
+}
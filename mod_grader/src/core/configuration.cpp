@@ -4,6 +4,7 @@
 
 // STL headers
 #include <fstream>
+#include <sstream>
 
 // BOOST headers
 #include <boost/property_tree/xml_parser.hpp>
@@ -27,11 +28,30 @@ const string configuration::SHMEM_NAME = "SHMEM_NAME";
 const string configuration::BASE_DIR = "BASE_DIR";
 const string configuration::SHMEM_SIZE = "SHMEM_SIZE";
 const string configuration::LIB_DIR = "LIB_DIR";
-const string configuration::SHELL = "SHELL";
-const string configuration::SHELL_CMD_FLAG = "SHELL_CMD_FLAG";
 const string configuration::LOG_DIR= "LOG_DIR";
 const string configuration::LOG_FILE= "LOG_FILE";
 const string configuration::LOG_LEVEL = "LOG_LEVEL";
+const string configuration::WORKERS = "WORKERS";
+const string configuration::QUEUE_SIZE = "QUEUE_SIZE";
+const string configuration::MAX_TASKS = "MAX_TASKS";
+const string configuration::TASK_TTL = "TASK_TTL";
+const string configuration::REAPER_INTERVAL_MS = "REAPER_INTERVAL_MS";
+const string configuration::TEST_THREADS = "TEST_THREADS";
+const string configuration::MAX_PARALLEL_TESTS = "MAX_PARALLEL_TESTS";
+const string configuration::WALL_TIME_FACTOR = "WALL_TIME_FACTOR";
+const string configuration::CGROUP_DIR = "CGROUP_DIR";
+const string configuration::OUTPUT_SLACK = "OUTPUT_SLACK";
+const string configuration::COMPILE_CACHE_DIR = "COMPILE_CACHE_DIR";
+const string configuration::COMPILE_CACHE_SIZE = "COMPILE_CACHE_SIZE";
+const string configuration::LONG_POLL_MAX_MS = "LONG_POLL_MAX_MS";
+const string configuration::SUITE_DIR = "SUITE_DIR";
+const string configuration::GENERATOR_DIR = "GENERATOR_DIR";
+const string configuration::GENERATOR_CACHE_DIR = "GENERATOR_CACHE_DIR";
+const string configuration::GENERATOR_CACHE_SIZE = "GENERATOR_CACHE_SIZE";
+const string configuration::GENERATOR_TIME_MS = "GENERATOR_TIME_MS";
+const string configuration::RESULT_CACHE_DIR = "RESULT_CACHE_DIR";
+const string configuration::RESULT_CACHE_SIZE = "RESULT_CACHE_SIZE";
+const string configuration::RESULT_CACHE_TTL = "RESULT_CACHE_TTL";
 
 configuration::configuration()
 {
@@ -47,6 +67,26 @@ configuration::map_type::const_iterator configuration::get(const std::string& ke
   return m_conf.find(key);
 }
 
+size_t configuration::get_number(const string& key, size_t defaultValue) const
+{
+  // Invalid value is reported, so typo in configuration doesn't go unnoticed
+  auto valueIt = get(key);
+  if (invalid() == valueIt || valueIt->second.empty())
+    return defaultValue;
+  try
+  {
+    return stoul(valueIt->second);
+  }
+  catch (const exception& e)
+  {
+    stringstream logmsg;
+    logmsg << "Invalid " << key << " in configuration, using default: " << defaultValue
+           << " Error message: " << e.what();
+    LOG(logmsg.str(), grader::WARNING);
+  }
+  return defaultValue;
+}
+
 configuration::grader_info configuration::get_grader(const string& languageName) const noexcept
 {
   auto it = m_languages.find(language(languageName, "", ""));
@@ -0,0 +1,258 @@
+// Project headers
+#include "epoch_manager.hpp"
+#include "task.hpp"
+#include "configuration.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+// BOOST headers
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_LONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Reader slots must be lock free to live in shared memory");
+
+namespace
+{
+  // Slot of calling thread (forked child gets its own, parent's slot still belongs to parent)
+  struct thread_reader
+  {
+    grader::epoch_manager::reader_slot* slot = nullptr;
+    pid_t pid = 0;
+    std::size_t depth = 0;
+    grader::epoch_manager::overflow_slot* overflow = nullptr;
+
+    ~thread_reader()
+    {
+      if (slot && getpid() == pid)
+        slot->owner.store(0);
+    }
+  };
+  thread_local thread_reader t_reader;
+}
+
+namespace grader
+{
+  const char* epoch_manager::SHM_NAME = "grader_epoch_manager";
+  constexpr size_t epoch_manager::READER_SLOTS;
+  constexpr size_t epoch_manager::OVERFLOW_SLOTS;
+
+  epoch_manager::guard::guard()
+  {
+    if (0 == t_reader.depth++)
+      instance().enter(t_reader.slot);
+  }
+
+  epoch_manager::guard::~guard()
+  {
+    if (0 == --t_reader.depth)
+      instance().leave(t_reader.slot);
+  }
+
+  epoch_manager::epoch_manager()
+  : m_epoch(1), m_retired(shm().get_segment_manager())
+  {
+  }
+
+  epoch_manager& epoch_manager::instance()
+  {
+    static epoch_manager* manager = shm().find_or_construct<epoch_manager>(SHM_NAME)();
+    return *manager;
+  }
+
+  void epoch_manager::enter(reader_slot* slot)
+  {
+    if (!slot || getpid() != t_reader.pid)
+      slot = t_reader.slot = claim_slot();
+
+    // Epoch is published before reader looks for anything (all operations are sequentially consistent)
+    if (slot)
+      slot->epoch.store(m_epoch.load());
+    else
+    {
+      // Process without overflow slot waits for some reader or overflow slot to be freed
+      while (!(t_reader.overflow = claim_overflow_slot()) && !(slot = t_reader.slot = claim_slot()))
+        this_thread::yield();
+      if (slot)
+        slot->epoch.store(m_epoch.load());
+      else
+        ++t_reader.overflow->readers;
+    }
+  }
+
+  void epoch_manager::leave(reader_slot* slot)
+  {
+    if (t_reader.overflow)
+    {
+      --t_reader.overflow->readers;
+      t_reader.overflow = nullptr;
+    }
+    else if (slot)
+      slot->epoch.store(0);
+  }
+
+  epoch_manager::reader_slot* epoch_manager::claim_slot()
+  {
+    // Free slot first, then slot of process that died
+    auto pid = getpid();
+    for (auto& slot : m_readers)
+    {
+      int expected = 0;
+      if (slot.owner.compare_exchange_strong(expected, pid))
+      {
+        t_reader.pid = pid;
+        return &slot;
+      }
+    }
+    for (auto& slot : m_readers)
+    {
+      int owner = slot.owner.load();
+      if (is_dead(owner) && slot.owner.compare_exchange_strong(owner, pid))
+      {
+        slot.epoch.store(0);
+        for (auto& entry : slot.pins)
+          entry.store(0);
+        t_reader.pid = pid;
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  epoch_manager::overflow_slot* epoch_manager::claim_overflow_slot()
+  {
+    // Slot stays with process until it dies, so only its own threads change count of readers
+    auto pid = getpid();
+    for (auto& slot : m_overflow)
+    {
+      if (pid == slot.owner.load())
+        return &slot;
+    }
+    for (auto& slot : m_overflow)
+    {
+      int owner = slot.owner.load();
+      if ((0 == owner || is_dead(owner)) && slot.owner.compare_exchange_strong(owner, pid))
+      {
+        slot.readers.store(0);
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  bool epoch_manager::overflow_readers()
+  {
+    // Readers of process that died will never leave, its slot is freed instead
+    for (auto& slot : m_overflow)
+    {
+      if (0 == slot.readers.load())
+        continue;
+      int owner = slot.owner.load();
+      if (!is_dead(owner))
+        return true;
+      slot.readers.store(0);
+      slot.owner.compare_exchange_strong(owner, 0);
+    }
+    return false;
+  }
+
+  void epoch_manager::retire(task* t)
+  {
+    // Task is already removed from task table, readers that enter in new epoch can't find it
+    {
+      boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+      m_retired.push_back(retired_task{static_cast<uint64_t>(shm().get_handle_from_address(t)), m_epoch.fetch_add(1)});
+    }
+    reclaim();
+  }
+
+  size_t epoch_manager::reclaim()
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    if (overflow_readers())
+      return 0;
+
+    // Task can be destroyed when every active reader entered after it was retired and nobody pinned it
+    // (pin is taken only under guard, so task that can't be found by any reader won't get new pin)
+    vector<uint64_t> pinned;
+    auto oldest = scan_readers(pinned);
+    sort(pinned.begin(), pinned.end());
+    size_t reclaimed = 0;
+    auto kept = m_retired.begin();
+    for (auto it = m_retired.begin(); it != m_retired.end(); ++it)
+    {
+      if (it->epoch < oldest && !binary_search(pinned.begin(), pinned.end(), it->handle))
+      {
+        task::free_task(static_cast<task*>(shm().get_address_from_handle(it->handle)));
+        ++reclaimed;
+      }
+      else
+        *kept++ = *it;
+    }
+    m_retired.erase(kept, m_retired.end());
+    return reclaimed;
+  }
+
+  size_t epoch_manager::retired()
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    return m_retired.size();
+  }
+
+  epoch_manager::pin_entry* epoch_manager::pin(task* t)
+  {
+    // Only owning thread fills entries of its slot, so free entry can't be taken by anybody else
+    if (!t_reader.slot || t_reader.overflow)
+      return nullptr;
+    for (auto& entry : t_reader.slot->pins)
+    {
+      if (0 == entry.load())
+      {
+        entry.store(static_cast<uint64_t>(shm().get_handle_from_address(t)));
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  uint64_t epoch_manager::scan_readers(vector<uint64_t>& pinned)
+  {
+    // Reader of process that died will never leave nor unpin, its slot is freed instead
+    auto oldest = numeric_limits<uint64_t>::max();
+    for (auto& slot : m_readers)
+    {
+      auto epoch = slot.epoch.load();
+      auto firstPinned = pinned.size();
+      for (auto& entry : slot.pins)
+      {
+        auto handle = entry.load();
+        if (0 != handle)
+          pinned.push_back(handle);
+      }
+      if (0 == epoch && firstPinned == pinned.size())
+        continue;
+      int owner = slot.owner.load();
+      if (is_dead(owner))
+      {
+        // Epoch and pins are cleared first, slot can be claimed by other process as soon as owner is cleared
+        slot.epoch.store(0);
+        for (auto& entry : slot.pins)
+          entry.store(0);
+        pinned.resize(firstPinned);
+        slot.owner.compare_exchange_strong(owner, 0);
+        continue;
+      }
+      if (0 != epoch)
+        oldest = min(oldest, epoch);
+    }
+    return oldest;
+  }
+}
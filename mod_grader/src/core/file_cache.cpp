@@ -0,0 +1,154 @@
+// Project headers
+#include "file_cache.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+// BOOST headers
+#include <boost/filesystem.hpp>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+static_assert(ATOMIC_LONG_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "File cache counters must be lock free to live in shared memory");
+
+namespace
+{
+  const char* TMP_SUFFIX = ".tmp";
+}
+
+namespace grader
+{
+  file_cache::file_cache(const string& name, const char* shmCountersName, const string& dirKey,
+                         const string& sizeKey, size_t defaultSize)
+  : m_name(name), m_maxSize(defaultSize), m_counters(shm().find_or_construct<counters>(shmCountersName)())
+  {
+    const configuration& conf = configuration::instance();
+    auto dirIt = conf.get(dirKey);
+    if (conf.invalid() == dirIt || dirIt->second.empty())
+      return;
+
+    m_maxSize = conf.get_number(sizeKey, defaultSize);
+
+    boost::system::error_code code;
+    fs::create_directories(dirIt->second, code);
+    if (boost::system::errc::success != code)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't create " << m_name << " directory: " << dirIt->second
+             << " Message: " << code.message() << " Cache is disabled.";
+      LOG(logmsg.str(), grader::ERROR);
+      return;
+    }
+    m_dir = dirIt->second;
+  }
+
+  string file_cache::tmp_path(const string& key) const
+  {
+    return entry_path(key) + TMP_SUFFIX + to_string(getpid());
+  }
+
+  bool file_cache::commit(const string& key, bool written)
+  {
+    auto tmpEntry = tmp_path(key);
+    boost::system::error_code code;
+    uintmax_t size = 0;
+    if (written)
+    {
+      size = fs::file_size(tmpEntry, code);
+      if (boost::system::errc::success == code)
+        fs::rename(tmpEntry, entry_path(key), code);
+    }
+    if (!written || boost::system::errc::success != code)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't store entry: " << key << " in " << m_name << ". Message: "
+             << (written ? code.message() : "entry wasn't written");
+      LOG(logmsg.str(), grader::WARNING);
+      fs::remove(tmpEntry, code);
+      return false;
+    }
+
+    auto totalSize = m_counters->bytes.fetch_add(size, memory_order_relaxed) + size;
+    if (totalSize > m_maxSize || !m_counters->sized.load())
+      evict();
+    return true;
+  }
+
+  void file_cache::touch(const string& key)
+  {
+    boost::system::error_code code;
+    fs::last_write_time(entry_path(key), time(nullptr), code);
+  }
+
+  void file_cache::remove(const string& key)
+  {
+    auto entry = entry_path(key);
+    boost::system::error_code code;
+    auto size = fs::file_size(entry, code);
+    if (!code && fs::remove(entry, code))
+      m_counters->bytes.fetch_sub(min<uintmax_t>(size, m_counters->bytes.load()), memory_order_relaxed);
+  }
+
+  void file_cache::evict()
+  {
+    // Worker that finds other worker scanning leaves eviction to it (unless that worker died while scanning)
+    int evictor = 0;
+    if (!m_counters->evictor.compare_exchange_strong(evictor, getpid()) &&
+        !(is_dead(evictor) && m_counters->evictor.compare_exchange_strong(evictor, getpid())))
+      return;
+
+    // Collect entries with their sizes and last write times (entries being written are left alone)
+    vector<pair<time_t, fs::path>> entries;
+    size_t totalSize = 0;
+    boost::system::error_code code;
+    for (fs::directory_iterator it(m_dir, code), end; !code && it != end; it.increment(code))
+    {
+      auto size = fs::file_size(it->path(), code);
+      time_t used = code ? 0 : fs::last_write_time(it->path(), code);
+      if (code)
+      {
+        // Entry removed by other worker in the meantime
+        code.clear();
+        continue;
+      }
+      totalSize += size;
+      if (string::npos == it->path().filename().string().find(TMP_SUFFIX))
+        entries.emplace_back(used, it->path());
+    }
+
+    // Remove least recently used entries until cache fits
+    if (totalSize > m_maxSize)
+    {
+      sort(entries.begin(), entries.end());
+      for (const auto& entry : entries)
+      {
+        if (totalSize <= m_maxSize)
+          break;
+        auto size = fs::file_size(entry.second, code);
+        if (!code && fs::remove(entry.second, code))
+        {
+          totalSize -= size;
+          m_counters->evictions.fetch_add(1, memory_order_relaxed);
+        }
+      }
+    }
+
+    // Scan replaces running total (entry stored while scanning may be off until next scan)
+    m_counters->bytes.store(totalSize, memory_order_relaxed);
+    m_counters->sized.store(true);
+    m_counters->evictor.store(0);
+  }
+}
@@ -24,23 +24,24 @@
 #include "grader_base.hpp"
 #include "configuration.hpp"
 #include "grader_log.hpp"
+#include "process.hpp"
+#include "comparator.hpp"
+#include "compile_cache.hpp"
 
 // STL headers
+#include <algorithm>
 #include <utility>
 #include <stdexcept>
 #include <iterator>
 #include <sstream>
+#include <fstream>
 
 // BOOST headers
 #include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/algorithm/string.hpp>
 
 // Poco headers
-#include <Poco/Process.h>
 #include <Poco/Pipe.h>
-#include <Poco/PipeStream.h>
-#include <Poco/StreamCopier.h>
 
 using namespace std;
 using namespace grader;
@@ -116,62 +117,43 @@ string grader_base::get_extension(const string& fileName) const
   return fileName.substr(pointPos + 1);
 }
 
-void grader_base::write_to_disk(const string& path, const string& content) const
+void grader_base::write_to_disk(const string& path, const char* content, size_t contentLen) const
 {
+  // Empty file can't be mapped, it's only created
+  if (0 == contentLen)
+  {
+    ofstream emptyFile(path, ios::trunc);
+    return;
+  }
+  
   boost::iostreams::mapped_file_params params;
   params.path = path;
-  params.new_file_size = content.length();
+  params.new_file_size = contentLen;
   params.flags = boost::iostreams::mapped_file::mapmode::readwrite;
   boost::iostreams::mapped_file mf;
   mf.open(params);
   if (mf.is_open())
-    copy(content.cbegin(), content.cend(), mf.data());
+    copy_n(content, contentLen, mf.data());
   else 
   {
     LOG("Couldn't open memory mapped file for writing: " + path + "Id: " + m_task->id(), grader::ERROR);
   }
 }
 
-boost::optional<Poco::ProcessHandle> grader_base::run_compile(string& flags, Poco::Pipe& errPipe) const
+bool grader_base::run_compile(vector<string>& args, string& compileErr) const
 {
-  // Get shell inline cmd execution flag
-  const configuration& conf = configuration::instance();
-  auto shellCMDFlag = conf.get(configuration::SHELL_CMD_FLAG);
-  bool hasCMDFlag = true;
-  if (conf.invalid() == shellCMDFlag)
+  // Source is either passed through stdin or written to disk and given as last argument
+  bool sourceOnStdin = !should_write_src_file();
+  if (sourceOnStdin)
   {
-    LOG("Does this shell have inline command execution flag? One not found in configuration.", grader::WARNING);
-  }
-  
-  vector<string> pocoFlags{hasCMDFlag ? shellCMDFlag->second : "", flags};
-  // Check if file needs to written to disk
-  if (!should_write_src_file())
-  {
-    Poco::Pipe stdinPipe;
-    auto shell = conf.get(configuration::SHELL);
-    if (conf.invalid() != shell)
-    {
-      auto ph = Poco::Process::launch(shell->second, pocoFlags, &stdinPipe, nullptr, &errPipe);
-      Poco::PipeOutputStream stdinPipeStream(stdinPipe);
-      stdinPipeStream << m_task->file_content();
-      stdinPipeStream.close();
-      return ph;
-    }
-    else 
-    {
-      stringstream logmsg;
-      logmsg << "Shell not present in configuration, program compilation not possible! "
-             << "Function: run_compile" 
-             << "Id: " << m_task->id();
-      LOG(logmsg.str(), grader::ERROR);
-      return boost::optional<Poco::ProcessHandle>{};
-    }
+    stringstream stdinFlag(compiler_stdin_flag());
+    args.insert(args.end(), istream_iterator<string>(stdinFlag), istream_iterator<string>());
   }
   else 
   {
-    // Write file to disk first and add file as a flag
-    write_to_disk(m_sourcePath, m_task->file_content());
-    pocoFlags[1] += " " + m_sourcePath;
+    // Write file to disk first and add file as an argument
+    write_to_disk(m_sourcePath, m_task->file_content(), m_task->file_content_size());
+    args.push_back(m_sourcePath);
     
     // Set permissions
     boost::system::error_code code;
@@ -183,7 +165,7 @@ boost::optional<Poco::ProcessHandle> grader_base::run_compile(string& flags, Poc
              << " Message: " << code.message() 
              << " Id: " << m_task->id();
       LOG(logmsg.str(), grader::ERROR);
-      return boost::optional<Poco::ProcessHandle>{};
+      return false;
     }
     boost::filesystem::permissions(m_dirPath, boost::filesystem::add_perms | boost::filesystem::others_write, code);
     if (boost::system::errc::success != code)
@@ -193,25 +175,36 @@ boost::optional<Poco::ProcessHandle> grader_base::run_compile(string& flags, Poc
              << " Message: " << code.message() 
              << " Id: " << m_task->id();
       LOG(logmsg.str(), grader::ERROR);
-      return boost::optional<Poco::ProcessHandle>{};
-    }
-    
-    // Launch compilation
-    auto shell = conf.get(configuration::SHELL);
-    if (conf.invalid() != shell)
-    {
-      return Poco::Process::launch(shell->second, pocoFlags, nullptr, nullptr, &errPipe);
+      return false;
     }
-    else 
+  }
+  
+  // Launch compiler directly (no shell), errors are collected while source is fed so neither side blocks
+  Poco::Pipe stdinPipe;
+  Poco::Pipe errPipe;
+  try 
+  {
+    auto ph = launch_process(compiler(), args, m_dirPath, sourceOnStdin ? &stdinPipe : nullptr, nullptr, &errPipe,
+                             process_limits{});
+    const char* source = sourceOnStdin ? m_task->file_content() : nullptr;
+    size_t sourceLen = sourceOnStdin ? m_task->file_content_size() : 0;
+    ph.communicate(sourceOnStdin ? &stdinPipe : nullptr, source, sourceLen, &errPipe,
+                   [&compileErr](const char* data, size_t len) { compileErr.append(data, len); return true; });
+    if (ph.wait().success())
     {
-      stringstream logmsg;
-      logmsg << "Shell not present in configuration, program compilation not possible! "
-             << "Function: run_compile" 
-             << "Id: " << m_task->id();
-      LOG(logmsg.str(), grader::ERROR);
-      return boost::optional<Poco::ProcessHandle>{};
+      compileErr.clear();
+      return true;
     }
+  } 
+  catch (const exception& e) 
+  {
+    stringstream logmsg;
+    logmsg << "Couldn't start compiler: " << compiler() << " Error message: " << e.what()
+           << " Function: run_compile "
+           << "Id: " << m_task->id();
+    LOG(logmsg.str(), grader::ERROR);
   }
+  return false;
 }
 
 bool grader_base::compile(string& compileErr) const
@@ -221,85 +214,129 @@ bool grader_base::compile(string& compileErr) const
   {
     if (should_write_src_file())
     {
-      write_to_disk(m_sourcePath, m_task->file_content());
+      write_to_disk(m_sourcePath, m_task->file_content(), m_task->file_content_size());
     }
     return true;
   }
   
-  // Set up compiler command and it's arguments
-  string flags; 
-  flags += compiler();
-  flags += ' ';
-  compiler_flags(flags);
-  flags += ' ';
+  // Set up compiler arguments
+  string compilerFlags;
+  compiler_flags(compilerFlags);
+  stringstream flagsStream(compilerFlags);
+  vector<string> args{istream_iterator<string>(flagsStream), istream_iterator<string>()};
   
   // In some cases there's no need to specify output for compiler (Java for example)
   string compilerFilenameFlag = compiler_filename_flag();
   if (!compilerFilenameFlag.empty())
   {
-    flags += compilerFilenameFlag;
-    flags += ' ' + m_executablePath;
+    args.push_back(compilerFilenameFlag);
+    args.push_back(m_executablePath);
   }
   
-  // Launch compiler
-  Poco::Pipe errPipe;
-  auto phOpt = run_compile(flags, errPipe);
-  if (!phOpt)
+  // Identical source was already compiled, reuse executable (only when compiler output is known)
+  compile_cache& cache = compile_cache::instance();
+  bool cacheable = cache.enabled() && !compilerFilenameFlag.empty();
+  string cacheKey;
+  if (cacheable)
+  {
+    cacheKey = cache.key(language(), compiler(), compilerFlags, m_task->file_name(), 
+                         m_task->file_content(), m_task->file_content_size());
+    if (cache.fetch(cacheKey, m_executablePath))
+      return true;
+  }
+  
+  // Launch compiler and wait for it to finish, compileErr gets error data if any
+  if (!run_compile(args, compileErr))
     return false;
-  auto ph = *phOpt;
   
-  // Wait for process to finish and return error data if any
-  int retCode = ph.wait();
-  if (0 != retCode)
+  if (cacheable)
+    cache.store(cacheKey, m_executablePath);
+  return true;
+}
+
+string grader_base::test_dir_path(size_t testNo) const
+{
+  return m_dirPath + "/test" + to_string(testNo);
+}
+
+process_limits grader_base::test_limits(size_t testNo) const
+{
+  const configuration& conf = configuration::instance();
+  process_limits limits;
+  limits.memoryBytes = m_task->memory_bytes();
+  limits.cpuTimeMS = m_task->time_ms();
+  
+  // Wall time limit is more relaxed than CPU time limit (process can wait on I/O or for free core)
+  size_t wallTimeFactor = max<size_t>(conf.get_number(configuration::WALL_TIME_FACTOR, DEFAULT_WALL_TIME_FACTOR), 1);
+  limits.wallTimeMS = limits.cpuTimeMS * wallTimeFactor;
+  
+  // Memory is limited with cgroup (if grader has delegated cgroup) so breaches can be detected
+  auto cgroupDirIt = conf.get(configuration::CGROUP_DIR);
+  if (conf.invalid() != cgroupDirIt && !cgroupDirIt->second.empty())
   {
-    Poco::PipeInputStream errPipeStream(errPipe);
-    if (!errPipeStream.fail())
-    {
-      compileErr = move(string(istreambuf_iterator<char>(errPipeStream),
-                                istreambuf_iterator<char>()));
-    }
-    else 
-    {
-      stringstream logmsg;
-      logmsg << "Couldn't set compiler error, input stream from compiler process failed. "
-             << "Function: compile"
-             << "Id: " << m_task->id();
-      LOG(logmsg.str(), grader::WARNING);
-    }
-    return false;
+    limits.cgroupDir = cgroupDirIt->second + "/" + m_task->id() + "-test" + to_string(testNo);
   }
-  return true;
+  return limits;
 }
 
-bool grader_base::run_test(const test& t) const
+test_report grader_base::report_from_status(const process_status& status)
 {
-  const subtest& in = t.first;
-  const subtest& out = t.second;
+  test_report report;
+  if (status.memoryExceeded)
+    report.result = verdict::MEMORY_LIMIT;
+  else if (status.wallTimeExceeded || status.cpuTimeExceeded)
+    report.result = verdict::TIME_LIMIT;
+  report.wallTimeMS = status.wallTimeMS;
+  report.cpuTimeMS = status.cpuTimeMS;
+  report.peakMemoryKB = status.peakMemoryKB;
+  report.signal = status.signal;
+  return report;
+}
+
+test_report grader_base::run_test(const test_view& t, size_t testNo) const
+{
+  const subtest_view& in = t.first;
+  const subtest_view& out = t.second;
   Poco::Pipe toExecutable, fromExecutable;
   
+  // Every test gets its own scratch directory so tests can run in parallel (file tests use same paths)
+  test_env env{test_dir_path(testNo), test_limits(testNo)};
+  boost::system::error_code code;
+  boost::filesystem::create_directories(env.dir, code);
+  if (boost::system::errc::success != code)
+  {
+    stringstream logmsg;
+    logmsg << "Error when creating test directory: " << env.dir
+           << " Message: " << code.message()
+           << " Id: " << m_task->id();
+    LOG(logmsg.str(), grader::ERROR);
+    return test_report{};
+  }
+  boost::filesystem::permissions(env.dir, boost::filesystem::add_perms | boost::filesystem::others_write, code);
+  
   // Case when both i/o are from standard streams
   if (subtest::subtest_i_o::STD == in.io() && subtest::subtest_i_o::STD == out.io())
-    return run_test_std_std(in, out, m_executablePath, toExecutable, fromExecutable);
+    return run_test_std_std(in, out, m_executablePath, env, toExecutable, fromExecutable);
   
   // Case when input comes as a command line args and executable output is written to stdout
   else if (subtest::subtest_i_o::CMD == in.io() && subtest::subtest_i_o::STD == out.io())
-    return run_test_cmd_std(in, out, m_executablePath, fromExecutable);
+    return run_test_cmd_std(in, out, m_executablePath, env, fromExecutable);
   
   // Case when input comes as file and executable output is written to stdout
   else if (subtest::subtest_i_o::FILE == in.io() && subtest::subtest_i_o::STD == out.io())
-    return run_test_file_std(in, out, m_executablePath, fromExecutable);
+    return run_test_file_std(in, out, m_executablePath, env, fromExecutable);
   
   // Case when input is stdin and output goes to file
   else if (subtest::subtest_i_o::STD == in.io() && subtest::subtest_i_o::FILE == out.io())
-    return run_test_std_file(in, out, m_executablePath, toExecutable);
+    return run_test_std_file(in, out, m_executablePath, env, toExecutable);
   
   // Case when input comes as cmd line arguments and output goes to file
   else if (subtest::subtest_i_o::CMD == in.io() && subtest::subtest_i_o::FILE == out.io())
-    return run_test_cmd_file(in, out, m_executablePath);
+    return run_test_cmd_file(in, out, m_executablePath, env);
   
   // Case when input is file and output goes to file
   else if (subtest::subtest_i_o::FILE == in.io() && subtest::subtest_i_o::FILE == out.io())
-    return run_test_file_file(in, out, m_executablePath);
+    return run_test_file_file(in, out, m_executablePath, env);
   
   // Unknown case
   stringstream logmsg;
@@ -307,35 +344,23 @@ bool grader_base::run_test(const test& t) const
          << "Function: run_test "
          << "Id: " << m_task->id();
   LOG(logmsg.str(), grader::WARNING);
-  return false;
+  return test_report{};
 }
 
-bool grader_base::run_test_std_std(const subtest& in, const subtest& out, const string& executable, 
+test_report grader_base::run_test_std_std(const subtest_view& in, const subtest_view& out, const string& executable, const test_env& env,
                                    Poco::Pipe& toExecutable, Poco::Pipe& fromExecutable) const
 {
-  auto ph = start_executable_process(executable, vector<string>{}, m_dirPath, &toExecutable, &fromExecutable);
-  Poco::PipeOutputStream toExecutableStream(toExecutable);
-  Poco::PipeInputStream fromExecutableStream(fromExecutable);
-  toExecutableStream << in.content().c_str();
-  if (toExecutableStream.fail())
-  {
-    stringstream logmsg;
-    logmsg << "Input stream to process failed. "
-           << "Function: run_test_std_std "
-           << "Id: " << m_task->id();
-    LOG(logmsg.str(), grader::WARNING);
-    return false;
-  }
-  toExecutableStream.close();
+  auto ph = start_executable_process(executable, vector<string>{}, env.dir, &toExecutable, &fromExecutable, env.limits);
   
-  return evaluate_output_stdin(fromExecutableStream, out, ph);
+  // Input is fed while output is read, program that writes before reading everything can't deadlock
+  return evaluate_output_stdin(in.content().data(), in.content().size(), &toExecutable, fromExecutable, out, ph);
 }
 
-bool grader_base::run_test_cmd_std(const subtest& in, const subtest& out, 
-                                   const string& executable, Poco::Pipe& fromExecutable) const
+test_report grader_base::run_test_cmd_std(const subtest_view& in, const subtest_view& out, 
+                                   const string& executable, const test_env& env, Poco::Pipe& fromExecutable) const
 {
   stringstream argsStream;
-  argsStream << in.content().c_str();
+  argsStream.write(in.content().data(), in.content().size());
   if (argsStream.fail())
   {
     stringstream logmsg;
@@ -343,31 +368,27 @@ bool grader_base::run_test_cmd_std(const subtest& in, const subtest& out,
            << "Function: run_test_cmd_std "
            << "Id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
   vector<string> args{istream_iterator<string>(argsStream), istream_iterator<string>()};
-  auto ph = start_executable_process(executable, args, m_dirPath, nullptr, &fromExecutable);
-  Poco::PipeInputStream fromExecutableStream(fromExecutable);
-  
-  return evaluate_output_stdin(fromExecutableStream, out, ph);
+  auto ph = start_executable_process(executable, args, env.dir, nullptr, &fromExecutable, env.limits);
+  return evaluate_output_stdin(nullptr, 0, nullptr, fromExecutable, out, ph);
 }
 
-bool grader_base::run_test_file_std(const subtest& in, const subtest& out, 
-                                    const string& executable, Poco::Pipe& fromExecutable) const
+test_report grader_base::run_test_file_std(const subtest_view& in, const subtest_view& out, 
+                                    const string& executable, const test_env& env, Poco::Pipe& fromExecutable) const
 {
   // Fill args and launch executable
-  vector<string> args{create_file_input(in)};
-  auto ph = start_executable_process(executable, args, m_dirPath, nullptr, &fromExecutable);
-  Poco::PipeInputStream fromExecutableStream(fromExecutable);
-  
-  return evaluate_output_stdin(fromExecutableStream, out, ph);
+  vector<string> args{create_file_input(in, env)};
+  auto ph = start_executable_process(executable, args, env.dir, nullptr, &fromExecutable, env.limits);
+  return evaluate_output_stdin(nullptr, 0, nullptr, fromExecutable, out, ph);
 }
 
-bool grader_base::run_test_std_file(const subtest& in, const subtest& out, const string& executable, 
-                                   Poco::Pipe& toExecutable) const
+test_report grader_base::run_test_std_file(const subtest_view& in, const subtest_view& out, const string& executable, 
+                                   const test_env& env, Poco::Pipe& toExecutable) const
 {
   using path_t = boost::filesystem::path;
-  string path = out.path().c_str();
+  string path = out.path().str();
   path_t p;
   try 
   {
@@ -380,7 +401,7 @@ bool grader_base::run_test_std_file(const subtest& in, const subtest& out, const
            << " Function: run_test_std_file"
            << "Task id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
   if (!p.is_relative()) 
   {
@@ -390,44 +411,35 @@ bool grader_base::run_test_std_file(const subtest& in, const subtest& out, const
            << "Path: " << path << ' '
            << "Id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
-  }
-  auto absolutePath = m_dirPath + '/' + path;
-  auto ph = start_executable_process(executable, vector<string>{move(path)}, m_dirPath, &toExecutable, nullptr);
-  Poco::PipeOutputStream toExecutableStream(toExecutable);
-  toExecutableStream << in.content().c_str();
-  if (toExecutableStream.fail())
-  {
-    stringstream logmsg;
-    logmsg << "Input stream to process failed. "
-           << "Function: run_test_std_file "
-           << "Id: " << m_task->id();
-    LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
-  toExecutableStream.close();
+  auto absolutePath = env.dir + '/' + path;
+  auto ph = start_executable_process(executable, vector<string>{move(path)}, env.dir, &toExecutable, nullptr, env.limits);
+  
+  // Program that stops reading input must not block grader until wall time limit
+  ph.communicate(&toExecutable, in.content().data(), in.content().size(), nullptr, nullptr);
   
   return evaluate_output_file(absolutePath, out, ph);
 }
 
-bool grader_base::run_test_cmd_file(const subtest& in, const subtest& out, const string& executable) const
+test_report grader_base::run_test_cmd_file(const subtest_view& in, const subtest_view& out, const string& executable, const test_env& env) const
 {
   // Check path first
-  string path = out.path().c_str();
+  string path = out.path().str();
   using path_t = boost::filesystem::path;
   path_t p;
   try 
   {
     p = path_t(path);
   } 
-  catch (const exception e) 
+  catch (const exception& e) 
   {
     stringstream logmsg;
     logmsg << "Invalid output path name. Error message: " << e.what()
            << " Function: run_test_cmd_file"
            << "Task id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
   
   if (!p.is_relative()) 
@@ -438,14 +450,14 @@ bool grader_base::run_test_cmd_file(const subtest& in, const subtest& out, const
            << "Path: " << path << ' '
            << "Id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
-  auto absolutePath = m_dirPath + '/' + path;
+  auto absolutePath = env.dir + '/' + path;
   
   // Fill args list
   vector<string> args{move(path)};
   stringstream argsStream;
-  argsStream << in.content().c_str();
+  argsStream.write(in.content().data(), in.content().size());
   if (argsStream.fail())
   {
     stringstream logmsg;
@@ -453,19 +465,18 @@ bool grader_base::run_test_cmd_file(const subtest& in, const subtest& out, const
            << "Function: run_test_cmd_file "
            << "Id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
-    return false;
+    return test_report{};
   }
   args.insert(args.begin() + 1, istream_iterator<string>(argsStream), istream_iterator<string>());
-  auto ph = start_executable_process(executable, args, m_dirPath, nullptr, nullptr);
+  auto ph = start_executable_process(executable, args, env.dir, nullptr, nullptr, env.limits);
   
   return evaluate_output_file(absolutePath, out, ph);
 }
 
-bool grader_base::run_test_file_file(const subtest& in, const subtest& out, const string& executable) const
+test_report grader_base::run_test_file_file(const subtest_view& in, const subtest_view& out, const string& executable, const test_env& env) const
 {
-  vector<string> args{create_file_input(in)};
-  string path = out.path().c_str();
+  vector<string> args{create_file_input(in, env)};
+  string path = out.path().str();
   using path_t = boost::filesystem::path;
   path_t p;
   try 
@@ -479,7 +490,7 @@ bool grader_base::run_test_file_file(const subtest& in, const subtest& out, cons
            << " Function: run_test_file_file"
            << "Task id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
   if (!p.is_relative()) 
   {
@@ -489,18 +500,18 @@ bool grader_base::run_test_file_file(const subtest& in, const subtest& out, cons
            << "Path: " << path << ' '
            << "Id: " << m_task->id();
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return test_report{};
   }
-  auto absolutePath = m_dirPath + '/' + path;
+  auto absolutePath = env.dir + '/' + path;
   args.push_back(move(path));
-  auto ph = start_executable_process(executable, args, m_dirPath, nullptr, nullptr);
+  auto ph = start_executable_process(executable, args, env.dir, nullptr, nullptr, env.limits);
   
   return evaluate_output_file(absolutePath, out, ph);
 }
 
-vector<string> grader_base::create_file_input(const subtest& in) const
+vector<string> grader_base::create_file_input(const subtest_view& in, const test_env& env) const
 {
-  string path = in.path().c_str();
+  string path = in.path().str();
   using path_t = boost::filesystem::path;
   path_t p;
   try 
@@ -526,8 +537,8 @@ vector<string> grader_base::create_file_input(const subtest& in) const
     LOG(logmsg.str(), grader::WARNING);
     return vector<string>{};
   }
-  string absolutePath = m_dirPath + '/' + path;
-  write_to_disk(absolutePath, in.content().c_str());
+  string absolutePath = env.dir + '/' + path;
+  write_to_disk(absolutePath, in.content().data(), in.content().size());
   boost::system::error_code code;
   boost::filesystem::permissions(absolutePath, boost::filesystem::add_perms | boost::filesystem::others_read, code);
   if (boost::system::errc::success != code)
@@ -543,70 +554,73 @@ vector<string> grader_base::create_file_input(const subtest& in) const
   return move(vector<string>{move(path)});
 }
 
-bool grader_base::evaluate_output_stdin(Poco::PipeInputStream& fromExecutableStream, const subtest& out, 
-                                        const Poco::ProcessHandle& ph) const
+test_report grader_base::evaluate_output_stdin(const char* input, size_t inputLen, Poco::Pipe* toExecutable,
+                                               Poco::Pipe& fromExecutable, const subtest_view& out, process_handle& ph) const
 {
-  int retCode = ph.wait();
-  if (0 != retCode) return false;
-  if (fromExecutableStream.fail())
-  {
-    stringstream logmsg;
-    logmsg << "Output stream from program failed. "
-           << "Function: evaluate_output_stdin "
-           << "Id: " << m_task->id();
-    LOG(logmsg.str(), grader::WARNING);
-    return false;
-  }
-  stringstream result;
-  result << fromExecutableStream.rdbuf();
-  if (result.fail())
-  {
-    stringstream logmsg;
-    logmsg << "Reading output from program to stringstream failed. "
-           << "Function: evaluate_output_stdin "
-           << "Id: " << m_task->id();
-    LOG(logmsg.str(), grader::WARNING);
-    return false;
-  }
-  auto resStr = move(result.str());
-  boost::trim(resStr);
-  return resStr == out.content().c_str();
+  // Compare output chunk by chunk as program writes it (program is killed at first difference)
+  auto comparator = make_comparator(out.checker(), out.content().data(), out.content().size(), output_slack());
+  ph.communicate(toExecutable, input, inputLen, &fromExecutable, 
+                 [&comparator](const char* data, size_t len) { return comparator->feed(data, len); });
+  
+  const process_status& status = ph.wait();
+  test_report report = report_from_status(status);
+  if (comparator->failed() || !status.success()) return report;
+  report.result = comparator->finish() ? verdict::PASSED : verdict::FAILED;
+  return report;
 }
 
-// TODO: Switch to memory mapped file output evaluation
-bool grader_base::evaluate_output_file(const string& absolutePath, const subtest& out, const Poco::ProcessHandle& ph) const
+size_t grader_base::output_slack() const
 {
-  int retCode = ph.wait();
-  if (0 != retCode) return false;
+  return configuration::instance().get_number(configuration::OUTPUT_SLACK, output_comparator::DEFAULT_SLACK);
+}
+
+test_report grader_base::evaluate_output_file(const string& absolutePath, const subtest_view& out, process_handle& ph) const
+{
+  const process_status& status = ph.wait();
+  test_report report = report_from_status(status);
+  if (!status.success()) return report;
   
-  ifstream result(absolutePath);
-  if (!result.is_open())
+  boost::system::error_code ec;
+  auto outputSize = boost::filesystem::file_size(absolutePath, ec);
+  if (ec)
   {
     stringstream logmsg;
-    logmsg << "Failed to open file with program output. "
-           << "Function: evaluate_output_file "
+    logmsg << "Failed to open file with program output. Error message: " << ec.message()
+           << " Function: evaluate_output_file "
            << "Id: " << m_task->id()
            << "Path: " << absolutePath;
     LOG(logmsg.str(), grader::WARNING);
-    return false;
+    return report;
   }
-  string resStr{istreambuf_iterator<char>(result), istreambuf_iterator<char>()};
-  if (result.fail())
+  
+  // Compare output in place, mapping of empty file isn't possible so it's compared as empty output
+  auto comparator = make_comparator(out.checker(), out.content().data(), out.content().size(), output_slack());
+  if (0 != outputSize)
   {
-    stringstream logmsg;
-    logmsg << "Reading program output from file into string failed (stream failed). "
-           << "Function: evaluate_output_file "
-           << "Id: " << m_task->id()
-           << "Path: " << absolutePath;
-    LOG(logmsg.str(), grader::WARNING);
-    return false;
+    boost::iostreams::mapped_file_source result;
+    try 
+    {
+      result.open(absolutePath);
+    } 
+    catch (const exception& e) 
+    {
+      stringstream logmsg;
+      logmsg << "Failed to memory map file with program output. Error message: " << e.what()
+             << " Function: evaluate_output_file "
+             << "Id: " << m_task->id()
+             << "Path: " << absolutePath;
+      LOG(logmsg.str(), grader::WARNING);
+      return report;
+    }
+    comparator->feed(result.data(), result.size());
   }
-  boost::trim(resStr);
-  return resStr == out.content().c_str();
+  report.result = comparator->finish() ? verdict::PASSED : verdict::FAILED;
+  return report;
 }
 
-Poco::ProcessHandle grader_base::start_executable_process(const string& executable, const vector< string >& args, const string& workingDir, 
-                                                          Poco::Pipe* toExecutable, Poco::Pipe* fromExecutable) const
+process_handle grader_base::start_executable_process(const string& executable, const vector< string >& args, const string& workingDir, 
+                                                     Poco::Pipe* toExecutable, Poco::Pipe* fromExecutable, 
+                                                     const process_limits& limits) const
 {
-  return Poco::Process::launch(executable, args, workingDir, toExecutable, fromExecutable, nullptr);
+  return launch_process(executable, args, workingDir, toExecutable, fromExecutable, nullptr, limits);
 }
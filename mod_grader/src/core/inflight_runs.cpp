@@ -0,0 +1,75 @@
+// Project headers
+#include "inflight_runs.hpp"
+#include "configuration.hpp"
+
+// STL headers
+#include <algorithm>
+#include <string>
+
+// BOOST headers
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+using namespace std;
+
+namespace grader
+{
+  const char* inflight_runs::SHM_NAME = "grader_inflight_runs";
+
+  inflight_runs::inflight_runs()
+  : m_runs(std::less<fingerprint>(), shm().get_segment_manager()), m_followers(0)
+  {
+  }
+
+  inflight_runs& inflight_runs::instance()
+  {
+    static inflight_runs* runs = shm().find_or_construct<inflight_runs>(SHM_NAME)();
+    return *runs;
+  }
+
+  bool inflight_runs::join(task* newTask)
+  {
+    fingerprint key;
+    auto hash = newTask->fingerprint();
+    auto hashLen = min(hash.size(), sizeof(key.hash) - 1);
+    copy_n(hash.cbegin(), hashLen, key.hash);
+    key.hash[hashLen] = '\0';
+
+    // Leader that already ended (or got destroyed) is replaced by new task
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    auto runIt = m_runs.find(key);
+    if (m_runs.end() != runIt)
+    {
+      auto leader = task::find(runIt->second.leaderId);
+      if (leader && leader->add_follower(newTask))
+      {
+        m_followers.fetch_add(1, memory_order_relaxed);
+        return true;
+      }
+    }
+
+    run newRun;
+    strncpy(newRun.leaderId, newTask->id(), sizeof(newRun.leaderId) - 1);
+    newRun.leaderId[sizeof(newRun.leaderId) - 1] = '\0';
+    m_runs[key] = newRun;
+    newTask->lead(key.hash);
+    return false;
+  }
+
+  void inflight_runs::leave(const char* hash, const char* leaderId)
+  {
+    // Entry is removed only by task that leads it
+    fingerprint key;
+    strncpy(key.hash, hash, sizeof(key.hash) - 1);
+    key.hash[sizeof(key.hash) - 1] = '\0';
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    auto runIt = m_runs.find(key);
+    if (m_runs.end() != runIt && 0 == strcmp(runIt->second.leaderId, leaderId))
+      m_runs.erase(runIt);
+  }
+
+  size_t inflight_runs::size()
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    return m_runs.size();
+  }
+}
@@ -0,0 +1,106 @@
+// Project headers
+#include "result_cache.hpp"
+#include "configuration.hpp"
+#include "hash.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+// BOOST headers
+#include <boost/filesystem.hpp>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace
+{
+  // Entry is final state on first line, size of status JSON on second line, then status and test events
+  const char* FINISHED_LINE = "FINISHED";
+  const char* COMPILE_ERROR_LINE = "COMPILE_ERROR";
+}
+
+namespace grader
+{
+  const char* result_cache::SHM_COUNTERS_NAME = "grader_result_cache_counters";
+  constexpr size_t result_cache::DEFAULT_SIZE;
+  constexpr size_t result_cache::DEFAULT_TTL_S;
+
+  result_cache::result_cache()
+  : m_files("result cache", SHM_COUNTERS_NAME, configuration::RESULT_CACHE_DIR,
+            configuration::RESULT_CACHE_SIZE, DEFAULT_SIZE),
+    m_ttlS(configuration::instance().get_number(configuration::RESULT_CACHE_TTL, DEFAULT_TTL_S))
+  {
+  }
+
+  result_cache& result_cache::instance()
+  {
+    static result_cache cache;
+    return cache;
+  }
+
+  string result_cache::key(const string& language, const string& graderLib, const char* suiteHash,
+                           const char* fileName, const char* source, size_t sourceLen) const
+  {
+    // Rebuilt grader library can grade differently, so its identity is part of key
+    boost::system::error_code code;
+    stringstream libIdentity;
+    libIdentity << graderLib << ':' << fs::file_size(graderLib, code) << ':' << fs::last_write_time(graderLib, code);
+
+    sha1_hasher hasher;
+    hasher.update(language.c_str(), language.size() + 1).update(libIdentity.str());
+    hasher.update(suiteHash, strlen(suiteHash) + 1).update(fileName, strlen(fileName) + 1);
+    hasher.update(&sourceLen, sizeof(sourceLen)).update(source, sourceLen);
+    return hasher.hex_digest();
+  }
+
+  bool result_cache::fetch(const string& key, task::state& finalState, string& status, string& events)
+  {
+    // Expired entry is removed, so it's stored again with fresh result
+    auto entry = m_files.entry_path(key);
+    boost::system::error_code code;
+    time_t stored = fs::last_write_time(entry, code);
+    bool found = !code;
+    if (found && static_cast<size_t>(max<time_t>(time(nullptr) - stored, 0)) > m_ttlS)
+    {
+      m_files.remove(key);
+      found = false;
+    }
+
+    // Entry of older format (without status size) is just a miss, it's replaced with fresh result
+    string stateLine;
+    size_t statusSize;
+    ifstream in;
+    if (found)
+      in.open(entry, ios::binary);
+    if (found && in && getline(in, stateLine) && in >> statusSize && '\n' == in.get() &&
+        (FINISHED_LINE == stateLine || COMPILE_ERROR_LINE == stateLine))
+    {
+      stringstream content;
+      content << in.rdbuf();
+      auto contentStr = content.str();
+      if (contentStr.size() >= statusSize)
+      {
+        finalState = FINISHED_LINE == stateLine ? task::state::FINISHED : task::state::COMPILE_ERROR;
+        status = contentStr.substr(0, statusSize);
+        events = contentStr.substr(statusSize);
+        m_files.hit();
+        return true;
+      }
+    }
+    m_files.miss();
+    return false;
+  }
+
+  void result_cache::store(const string& key, task::state finalState, const string& status, const string& events)
+  {
+    ofstream out(m_files.tmp_path(key), ios::binary | ios::trunc);
+    out << (task::state::FINISHED == finalState ? FINISHED_LINE : COMPILE_ERROR_LINE) << '\n' << status.size() << '\n'
+        << status << events;
+    out.close();
+    m_files.commit(key, static_cast<bool>(out));
+  }
+}
@@ -8,28 +8,27 @@
 
 // BOOST headers
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/algorithm/string.hpp>
 
 using namespace std;
 
 namespace grader 
 {
-  subtest::subtest(subtest::subtest_type type, std::string& cont, subtest::subtest_i_o IO, const std::string& path)
-  : m_type(type), m_content(shm().get_segment_manager()), m_io(IO), m_path(shm().get_segment_manager())
+  subtest::subtest(subtest::subtest_type type, const subtest_view& view)
+  : m_type(type), m_content(shm().get_segment_manager()), m_io(view.io()), m_path(shm().get_segment_manager()), 
+    m_checker(view.checker())
   {
-    // Copy content
-    if (subtest_out == type)
-      boost::trim(cont);
-    m_content.reserve(cont.size()+1);
-    m_content.insert(m_content.begin(), cont.cbegin(), cont.cend());
+    // Copy content (expected output is already trimmed by suite parser)
+    m_content.reserve(view.content().size()+1);
+    m_content.insert(m_content.begin(), view.content().begin(), view.content().end());
     
     // Copy path 
-    m_path.reserve(path.size()+1);
-    m_path.insert(m_path.begin(), path.cbegin(), path.cend());
+    m_path.reserve(view.path().size()+1);
+    m_path.insert(m_path.begin(), view.path().begin(), view.path().end());
   }
   
   subtest::subtest(subtest&& oth)
-  : m_type(oth.m_type), m_content(boost::move(oth.m_content)), m_io(oth.m_io), m_path(boost::move(oth.m_path))
+  : m_type(oth.m_type), m_content(boost::move(oth.m_content)), m_io(oth.m_io), m_path(boost::move(oth.m_path)),
+    m_checker(oth.m_checker)
   {
   }
   
@@ -41,10 +40,16 @@ namespace grader
       m_content = boost::move(oth.m_content);
       m_io = oth.m_io;
       m_path = boost::move(oth.m_path);
+      m_checker = oth.m_checker;
     }
     return *this;
   }
   
+  subtest_view subtest::view() const
+  {
+    return subtest_view(m_io, m_checker, byte_span(m_content.data(), m_content.size()), byte_span(m_path.data(), m_path.size()));
+  }
+  
   subtest::subtest_i_o subtest::io_from_str(const string& ioStr)
   {
     if ("std" == ioStr)
@@ -0,0 +1,196 @@
+// Project headers
+#include "suite_file.hpp"
+#include "grader_log.hpp"
+#include "hash.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+// BOOST headers
+#include <boost/filesystem.hpp>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+
+namespace grader
+{
+  const char suite_file::MAGIC[8] = { 'G', 'R', 'S', 'U', 'I', 'T', 'E', '\0' };
+  constexpr uint32_t suite_file::VERSION;
+
+  suite_file::suite_file(const string& path)
+  : m_file(path), m_header(nullptr), m_tests(nullptr)
+  {
+    if (m_file.size() < sizeof(header))
+      return;
+    m_header = reinterpret_cast<const header*>(m_file.data());
+    m_tests = reinterpret_cast<const test_entry*>(m_file.data() + sizeof(header));
+  }
+
+  test_view suite_file::test(size_t testNo) const
+  {
+    return test_view(view(m_tests[testNo].in), view(m_tests[testNo].out));
+  }
+
+  byte_span suite_file::content_hash(size_t testNo, subtest::subtest_type type) const
+  {
+    const subtest_entry& entry = subtest::subtest_in == type ? m_tests[testNo].in : m_tests[testNo].out;
+    return byte_span(entry.hash, sizeof(entry.hash));
+  }
+
+  subtest_view suite_file::view(const subtest_entry& entry) const
+  {
+    checker_spec checker;
+    checker.kind = static_cast<checker_spec::checker_kind>(entry.checker);
+    checker.tolerance = entry.tolerance;
+    return subtest_view(static_cast<subtest::subtest_i_o>(entry.io), checker,
+                        byte_span(m_file.data() + entry.contentOffset, entry.contentLen),
+                        byte_span(m_file.data() + entry.pathOffset, entry.pathLen));
+  }
+
+  bool suite_file::valid() const
+  {
+    // File can come from older grader or be truncated, nothing in it is trusted before it's checked
+    if (!m_header || 0 != memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) || VERSION != m_header->version)
+      return false;
+    if (m_header->testCount > (m_file.size() - sizeof(header)) / sizeof(test_entry))
+      return false;
+    for (size_t i = 0; i < m_header->testCount; ++i)
+    {
+      if (!valid_entry(m_tests[i].in) || !valid_entry(m_tests[i].out))
+        return false;
+    }
+    return true;
+  }
+
+  bool suite_file::valid_entry(const subtest_entry& entry) const
+  {
+    // Strings must fit in file together with terminal zero
+    auto fits = [this](uint64_t offset, uint64_t len)
+    {
+      return offset <= m_file.size() && len < m_file.size() - offset && '\0' == m_file.data()[offset + len];
+    };
+    return fits(entry.contentOffset, entry.contentLen) && fits(entry.pathOffset, entry.pathLen) &&
+           entry.io <= static_cast<uint8_t>(subtest::subtest_i_o::FILE) &&
+           entry.checker <= static_cast<uint8_t>(checker_spec::checker_kind::FLOAT);
+  }
+
+  bool suite_file::write(const string& path, const vector<test_view>& tests, size_t memoryBytes, size_t timeMS,
+                         const string& language, size_t parallelism)
+  {
+    // Header and entries come first, data section follows them
+    header head;
+    memset(&head, 0, sizeof(head));
+    copy_n(MAGIC, sizeof(MAGIC), head.magic);
+    head.version = VERSION;
+    head.testCount = static_cast<uint32_t>(tests.size());
+    head.memoryBytes = memoryBytes;
+    head.timeMS = timeMS;
+    head.parallelism = parallelism;
+    copy_n(language.c_str(), min(language.size(), sizeof(head.language) - 1), head.language);
+
+    vector<test_entry> entries(tests.size());
+    uint64_t dataOffset = sizeof(header) + tests.size() * sizeof(test_entry);
+    auto fill = [&dataOffset](subtest_entry& entry, const subtest_view& view)
+    {
+      memset(&entry, 0, sizeof(entry));
+      entry.io = static_cast<uint8_t>(view.io());
+      entry.checker = static_cast<uint8_t>(view.checker().kind);
+      entry.tolerance = view.checker().tolerance;
+      entry.contentOffset = dataOffset;
+      entry.contentLen = view.content().size();
+      dataOffset += entry.contentLen + 1;
+      entry.pathOffset = dataOffset;
+      entry.pathLen = view.path().size();
+      dataOffset += entry.pathLen + 1;
+      auto hash = sha1_hasher().update(view.content().data(), view.content().size()).hex_digest();
+      copy_n(hash.c_str(), min(hash.size(), sizeof(entry.hash)), entry.hash);
+    };
+    for (size_t i = 0; i < tests.size(); ++i)
+    {
+      fill(entries[i].in, tests[i].first);
+      fill(entries[i].out, tests[i].second);
+    }
+
+    // Write under temporary name, rename is atomic so readers never map partial file
+    auto tmpPath = path + ".tmp" + to_string(getpid());
+    {
+      ofstream out(tmpPath, ios::binary | ios::trunc);
+      out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+      out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(test_entry));
+      for (const auto& t : tests)
+      {
+        for (const subtest_view* view : { &t.first, &t.second })
+        {
+          out.write(view->content().data(), view->content().size()).put('\0');
+          out.write(view->path().data(), view->path().size()).put('\0');
+        }
+      }
+      out.close();
+      if (!out)
+      {
+        stringstream logmsg;
+        logmsg << "Couldn't write compiled suite file: " << tmpPath;
+        LOG(logmsg.str(), grader::ERROR);
+        boost::system::error_code code;
+        boost::filesystem::remove(tmpPath, code);
+        return false;
+      }
+    }
+
+    boost::system::error_code code;
+    boost::filesystem::rename(tmpPath, path, code);
+    if (code)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't rename compiled suite file: " << tmpPath << " to: " << path << " Message: " << code.message();
+      LOG(logmsg.str(), grader::ERROR);
+      boost::filesystem::remove(tmpPath, code);
+      return false;
+    }
+    return true;
+  }
+
+  shared_ptr<const suite_file> suite_file::open(const string& path)
+  {
+    // Every suite file is mapped once per process, tests running in parallel share mapping
+    static mutex cacheLock;
+    static map<string, weak_ptr<const suite_file>> cache;
+    lock_guard<mutex> lock(cacheLock);
+    auto cached = cache[path].lock();
+    if (cached)
+      return cached;
+
+    // Forget files nobody uses anymore
+    for (auto it = cache.begin(); it != cache.end();)
+      it = it->second.expired() && it->first != path ? cache.erase(it) : next(it);
+
+    shared_ptr<suite_file> file;
+    try
+    {
+      file = make_shared<suite_file>(path);
+    }
+    catch (const exception& e)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't map compiled suite file: " << path << " Error message: " << e.what();
+      LOG(logmsg.str(), grader::ERROR);
+      return nullptr;
+    }
+    if (!file->valid())
+    {
+      stringstream logmsg;
+      logmsg << "Compiled suite file is corrupted or has unknown version: " << path;
+      LOG(logmsg.str(), grader::ERROR);
+      return nullptr;
+    }
+    cache[path] = file;
+    return file;
+  }
+}
@@ -2,7 +2,13 @@
 #include "task.hpp"
 #include "configuration.hpp"
 #include "grader_base.hpp"
+#include "hash.hpp"
+#include "inflight_runs.hpp"
+#include "epoch_manager.hpp"
+#include "result_cache.hpp"
 #include "shared_lib.hpp"
+#include "suite_file.hpp"
+#include "test_slots.hpp"
 
 // STL headers
 #include <algorithm>
@@ -11,34 +17,96 @@
 #include <string>
 #include <functional>
 #include <csetjmp>
+#include <new>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <thread>
 
 // BOOST headers
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/allocators/adaptive_pool.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
-
-#include <boost/uuid/uuid.hpp>            
-#include <boost/uuid/uuid_generators.hpp> 
-#include <boost/uuid/uuid_io.hpp>
-#include <boost/lexical_cast.hpp>
-
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include <boost/filesystem.hpp>
 
+// Linux headers
+#include <unistd.h>
+
 using namespace std;
 using namespace grader;
 
-task::mutex_type s_lock;
-const task::test_attributes task::INVALID_TEST_ATTR{0, 0, ""};
+constexpr char task::EVENT_SEPARATOR;
 
 jmp_buf g_saveStateBeforeTerminate;
+std::thread::id g_saveStateThread; // Only thread that saved state can jump back to it
+
+namespace
+{
+  // Room reserved in event log for every test (its result event and its part of final status)
+  constexpr size_t EVENT_BYTES_PER_TEST = 256;
+  
+  // Tasks come from pool of equally sized nodes with its own lock, they don't wait for segment lock every time
+  // (pool lock is taken before segment lock when pool needs new block)
+  using shm_task_pool = boost::interprocess::adaptive_pool<task, boost::interprocess::managed_shared_memory::segment_manager>;
+  shm_task_pool& task_pool()
+  {
+    // Pool in segment is destroyed together with its last allocator, so allocator of process is never destroyed
+    static shm_task_pool* pool = new shm_task_pool(shm().get_segment_manager());
+    return *pool;
+  }
+  
+  // Resources used by single test as JSON object
+  string metrics_to_json(const test_report& report)
+  {
+    stringstream json;
+    json << "{ "
+         << "\"WALL_MS\" : " << report.wallTimeMS << ", "
+         << "\"CPU_MS\" : " << report.cpuTimeMS << ", "
+         << "\"PEAK_RSS_KB\" : " << report.peakMemoryKB << ", "
+         << "\"SIGNAL\" : " << report.signal << " }";
+    return json.str();
+  }
+  
+  // Passed and failed tests are reported as 1 and 0, limit breaches with their short names
+  const char* verdict_to_json(verdict v)
+  {
+    switch (v) 
+    {
+      case verdict::PASSED:
+        return "1";
+      case verdict::TIME_LIMIT:
+        return "\"TLE\"";
+      case verdict::MEMORY_LIMIT:
+        return "\"MLE\"";
+      case verdict::FAILED:
+        break;
+    }
+    return "0";
+  }
+  
+  // Event published as soon as result of single test is known
+  string test_event(size_t testNo, const test_report& report)
+  {
+    stringstream json;
+    json << "{ \"TEST" << testNo << "\" : " << verdict_to_json(report.result) 
+         << ", \"METRICS\" : " << metrics_to_json(report) << " }" << task::EVENT_SEPARATOR;
+    return json.str();
+  }
+}
 
-task::task(const char* fileName, std::size_t fnLen, const char* fileContent, std::size_t fcLen, 
-            shm_test_vector&& tests, const boost::uuids::uuid& id, size_t memoryBytes, size_t timeMS, const string& language)
-: m_fileName(shm().get_segment_manager()), m_fileContent(shm().get_segment_manager()), m_tests(boost::move(tests)), 
-m_memoryBytes(memoryBytes), m_timeMS(timeMS), m_state(state::WAITING), m_status(shm().get_segment_manager())
+task::task(const char* fileName, std::size_t fnLen, shm_string&& fileContent, test_suite* suite, 
+           const char* id)
+: m_fileName(shm().get_segment_manager()), m_fileContent(boost::move(fileContent)), m_suite(suite), 
+m_state(state::WAITING), m_status(shm().get_segment_manager()), m_events(shm().get_segment_manager()), m_waiters(0),
+m_bypassCache(false), m_followers(shm().get_segment_manager()), m_owner(0), m_finishedAt(0)
 {
+  m_fingerprint[0] = '\0';
+  strncpy(m_id, id, sizeof(m_id) - 1);
+  m_id[sizeof(m_id) - 1] = '\0';
+  test_suite::acquire(suite);
+  
   // Correctly handle case when client sent relative file path (extract file name)
   using path_t = boost::filesystem::path;
   path_t tmpPath;
@@ -66,25 +134,23 @@ m_memoryBytes(memoryBytes), m_timeMS(timeMS), m_state(state::WAITING), m_status(
     set_state(state::INVALID);
     return;
   }
-  
-  // Copy file content
-  m_fileContent.reserve(fcLen + 1);
-  m_fileContent.insert(m_fileContent.begin(), fileContent, fileContent + fcLen);
-  
-  // Copy uuid
-  const string tmp = boost::lexical_cast<std::string>(id);
-  copy(tmp.cbegin(), tmp.cend(), m_id);
-  m_id[tmp.size()] = '\0';
-  
-  // Copy language
-  copy(language.cbegin(), language.cend(), m_language);
-  m_language[language.size()] = '\0';
+
+}
+
+task::~task()
+{
+  if (m_suite)
+    test_suite::release(m_suite.get());
 }
 
 task::task(task&& oth)
-: m_fileName(boost::move(oth.m_fileName)), m_fileContent(boost::move(oth.m_fileContent)), m_tests(boost::move(oth.m_tests)),
-m_memoryBytes(oth.m_memoryBytes), m_timeMS(oth.m_timeMS), m_state(oth.m_state), m_status(boost::move(oth.m_status))
+: m_fileName(boost::move(oth.m_fileName)), m_fileContent(boost::move(oth.m_fileContent)), m_suite(oth.m_suite),
+m_state(oth.m_state.load()), m_status(boost::move(oth.m_status)), m_events(boost::move(oth.m_events)), m_waiters(0),
+m_bypassCache(oth.m_bypassCache), m_followers(boost::move(oth.m_followers)), m_owner(oth.m_owner.load()),
+m_finishedAt(oth.m_finishedAt.load())
 {
+  copy_n(oth.m_fingerprint, sizeof(m_fingerprint), m_fingerprint);
+  oth.m_suite = nullptr;
 }
 
 task& task::operator=(task&& oth)
@@ -93,26 +159,41 @@ task& task::operator=(task&& oth)
   {
     m_fileName = boost::move(oth.m_fileName);
     m_fileContent = boost::move(oth.m_fileContent);
-    m_tests = boost::move(oth.m_tests);
-    m_memoryBytes = oth.m_memoryBytes;
-    m_timeMS = oth.m_timeMS;
-    m_state = oth.m_state;
+    if (m_suite)
+      test_suite::release(m_suite.get());
+    m_suite = oth.m_suite;
+    oth.m_suite = nullptr;
+    m_state.store(oth.m_state.load());
     m_status = boost::move(oth.m_status);
+    m_events = boost::move(oth.m_events);
+    m_bypassCache = oth.m_bypassCache;
+    copy_n(oth.m_fingerprint, sizeof(m_fingerprint), m_fingerprint);
+    m_followers = boost::move(oth.m_followers);
+    m_owner.store(oth.m_owner.load());
+    m_finishedAt.store(oth.m_finishedAt.load());
   }
   return *this;
 }
 
+void task::claim()
+{
+  m_owner.store(getpid());
+}
+
 void task::run_all()
 {
+  // Task taken from job_queue is already claimed, claiming again only covers tasks graded without queue
+  claim();
+  
   // Fetch grader informations for programming language
   const configuration& conf = configuration::instance();
-  auto graderInfo = conf.get_grader(m_language);
+  auto graderInfo = conf.get_grader(m_suite->language());
   
   // Check if grader for this language doesn't exists in config.xml
   if (configuration::INVALID_GR_INFO == graderInfo)
   {
     stringstream logmsg;
-    logmsg << "Couldn't find grader for language: " << m_language << " in config.xml.";
+    logmsg << "Couldn't find grader for language: " << m_suite->language() << " in config.xml.";
     logmsg << "Task id: " << m_id;
     LOG(logmsg.str(), grader::ERROR);
     set_state(state::INVALID);
@@ -135,10 +216,30 @@ void task::run_all()
   string libPath = baseLibPathIt->second + "/" + 
                             configuration::get_lib_name(graderInfo);
   
+  // Same source was already graded against same tests (bypassing task still refreshes cached result)
+  result_cache& resultCache = result_cache::instance();
+  string cacheKey;
+  if (resultCache.enabled())
+  {
+    cacheKey = resultCache.key(m_suite->language(), libPath, m_suite->hash(), m_fileName.c_str(), 
+                               m_fileContent.data(), m_fileContent.size());
+    state cachedState;
+    string cachedStatus, cachedEvents;
+    if (!m_bypassCache && resultCache.fetch(cacheKey, cachedState, cachedStatus, cachedEvents))
+    {
+      // Stream clients get same test events as from real run
+      m_status = cachedStatus.c_str();
+      publish_events(cachedEvents);
+      set_state(cachedState);
+      return;
+    }
+  }
+  
   // This function is place where third party grader plugins can crash
   // whole application, so std::terminate_handler will be replaced, saved
   // and restored upon successful completition or upon failure
   std::terminate_handler defaultHandler = set_terminate(&task::terminate_handler);
+  g_saveStateThread = this_thread::get_id();
   if (setjmp(g_saveStateBeforeTerminate) != 0)
   {
     // Log error
@@ -198,39 +299,72 @@ void task::run_all()
     auto jsonStr = move(formater.str());
     m_status.insert(m_status.begin(), jsonStr.cbegin(), jsonStr.cend());
     set_state(state::COMPILE_ERROR);
+    if (!cacheKey.empty())
+      resultCache.store(cacheKey, state::COMPILE_ERROR, jsonStr, string());
     return;
   }
   
+  // Events of whole run go to buffer reserved up front, so segment isn't locked again for every test
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    m_events.reserve(m_events.size() + EVENT_BYTES_PER_TEST * m_suite->size());
+  }
+  
   // Run tests
   set_state(task::state::RUNNING);
-  vector<bool> testResults;
-  testResults.reserve(m_tests.size());
-  for (const auto& t : m_tests)
+  vector<test_report> testResults;
+  if (!run_tests(*graderObj, testResults))
   {
-    bool res = graderObj->run_test(t);
-    testResults.push_back(res);
+    // Task without tests has no result (and nothing is cached for it)
+    set_state(state::INVALID);
+    set_terminate(defaultHandler);
+    return;
   }
   
-  // Construct status message
+  // Construct status message (verdicts first, then resources every test used)
   auto testResSize = testResults.size();
   formater << "{ \n\t\"STATE\" : \"FINISHED\",\n";
-  for (decltype(testResSize) i = 0; i < testResSize - 1; ++i)
+  for (decltype(testResSize) i = 0; i < testResSize; ++i)
   {
-    formater << "\t\"TEST" << i << "\" : " << to_string(testResults[i]) << " ,\n";
+    formater << "\t\"TEST" << i << "\" : " << verdict_to_json(testResults[i].result) << " ,\n";
   }
-  formater << "\t\"TEST" << (testResSize - 1) << "\" : " << to_string(testResults[testResSize - 1]) << " \n}";
+  formater << "\t\"METRICS\" : {\n";
+  for (decltype(testResSize) i = 0; i < testResSize; ++i)
+  {
+    formater << "\t\t\"TEST" << i << "\" : " << metrics_to_json(testResults[i])
+             << (i + 1 < testResSize ? ",\n" : "\n");
+  }
+  formater << "\t}\n}";
   auto jsonStr = move(formater.str());
   m_status = jsonStr.c_str();
   set_state(task::state::FINISHED);
   
+  // Limit verdicts depend on load of machine, so only results without them are reused
+  auto deterministic = none_of(testResults.cbegin(), testResults.cend(), [](const test_report& report)
+  {
+    return verdict::TIME_LIMIT == report.result || verdict::MEMORY_LIMIT == report.result;
+  });
+  if (!cacheKey.empty() && deterministic)
+  {
+    string testEvents;
+    for (decltype(testResSize) i = 0; i < testResSize; ++i)
+      testEvents += test_event(i, testResults[i]);
+    resultCache.store(cacheKey, state::FINISHED, jsonStr, testEvents);
+  }
+  
   // Restore default std::terminate_handler
   set_terminate(defaultHandler);
 }
 
 const char* task::status() const
 {
-  boost::interprocess::scoped_lock<mutex_type> lock(s_lock);
-  switch(m_state)
+  // Final status is written before final state is published and it never changes after that
+  return status_of(m_state.load(memory_order_acquire));
+}
+
+const char* task::status_of(state s) const
+{
+  switch(s)
   {
     case state::INVALID:
       return "{ \"STATE\" : \"INVALID\" }";
@@ -247,139 +381,332 @@ const char* task::status() const
   return "";
 }
 
-task* task::create_task(const char* fileName, std::size_t fnLen, const char* fileContent, 
-                        std::size_t fcLen, const char* testsContent, std::size_t testsCLen)
+task* task::create_task(const char* fileName, std::size_t fnLen, shm_string&& fileContent, test_suite* suite)
+{
+  // Suite is null when tests couldn't be parsed
+  if (!suite) return nullptr;
+  
+  // Task gets slot first, its id is handle of slot
+  task_table& table = task_table::instance();
+  shm_id id;
+  if (!table.reserve(id))
+  {
+    LOG("Couldn't reserve task id. If task table is full, increase MAX_TASKS in configuration or delete finished tasks.", grader::ERROR);
+    return nullptr;
+  }
+  task* newTask = nullptr;
+  try
+  {
+    newTask = task_pool().allocate_one().get();
+    new (newTask) task(fileName, fnLen, boost::move(fileContent), suite, id);
+  }
+  catch (const exception& e)
+  {
+    if (newTask)
+      task_pool().deallocate_one(newTask);
+    stringstream logmsg;
+    logmsg << "Couldn't construct task in shared memory. Error message: " << e.what();
+    LOG(logmsg.str(), grader::ERROR);
+    table.release(id);
+    return nullptr;
+  }
+  table.publish(id, newTask);
+  return newTask;
+}
+
+task::pin::pin(const char* id)
+: m_task(nullptr), m_entry(nullptr)
+{
+  // Pin is taken while guard still protects task, so task that was retired meanwhile isn't freed before it's unpinned
+  epoch_manager::guard readGuard;
+  m_task = find(id);
+  if (m_task && !(m_entry = epoch_manager::instance().pin(m_task)))
+    m_guard.reset(new epoch_manager::guard());
+}
+
+task::pin::~pin()
+{
+  if (m_entry)
+    epoch_manager::unpin(m_entry);
+}
+
+void task::destroy(task* t)
+{
+  // Id stops resolving first, memory is freed when readers that could have found task are gone
+  if (task_table::instance().release(t->id()))
+    epoch_manager::instance().retire(t);
+}
+
+void task::free_task(task* t)
 {
-  // Generate uuid
-  auto uuid = boost::uuids::random_generator()();
-  shm_test_vector tests(shm().get_segment_manager());
-  auto memTimeLang = parse_tests(testsContent, testsCLen, tests);
-  if (INVALID_TEST_ATTR == memTimeLang) return nullptr;
-  return shm().construct<task>(boost::uuids::to_string(uuid).c_str())(fileName, fnLen, fileContent, 
-                                                                      fcLen, move(tests), uuid, 
-                                                                      get<0>(memTimeLang), get<1>(memTimeLang),
-                                                                      get<2>(memTimeLang)
-                                                                      );
+  t->~task();
+  task_pool().deallocate_one(t);
 }
 
 bool task::is_valid_task_name(const char* name)
 {
-   stringstream interpreter;
-   boost::uuids::uuid tmp;
-   return interpreter<<name && 
-           interpreter>>tmp && 
-           interpreter.get() == stringstream::traits_type::eof();
+  task_table::handle h;
+  return task_table::parse(name, h);
 }
 
-task::test_attributes task::parse_tests(const char* testsContent, std::size_t testsCLen, task::shm_test_vector& tests)
+size_t task::parallelism() const
 {
-  // Read xml into property tree
-  using namespace boost::property_tree;
-  ptree pt;
-  istringstream testsInput(string(testsContent, testsContent + testsCLen));
-  try 
-  {
-    xml_parser::read_xml(testsInput, pt, xml_parser::no_comments);
-  } 
-  catch (const xml_parser::xml_parser_error& e) 
+  // Configuration gives default and upper bound for number of test threads, task can only lower it
+  size_t maxThreads = max<size_t>(configuration::instance().get_number(configuration::TEST_THREADS, 1), 1);
+  
+  size_t taskParallelism = m_suite->parallelism();
+  size_t threads = 0 == taskParallelism ? maxThreads : min(taskParallelism, maxThreads);
+  return min<size_t>(threads, m_suite->size());
+}
+
+bool task::run_tests(const grader_base& graderObj, vector<test_report>& testResults)
+{
+  // Test data is viewed in place (shared memory or mapped suite file), file stays mapped until tests are done,
+  // generated tests are produced here by first task of suite
+  vector<test_view> tests;
+  shared_ptr<const suite_file> suiteFile;
+  testResults.assign(m_suite->size(), test_report{});
+  if (!m_suite->prepare() || !m_suite->views(tests, suiteFile))
   {
     stringstream logmsg;
-    logmsg << "Couldn't parse tests content (check if tests are xml valid). "
-           << "Error message: " << e.what();
+    logmsg << "Couldn't load tests of suite: " << m_suite->hash() << " Task id: " << m_id;
     LOG(logmsg.str(), grader::ERROR);
-    return INVALID_TEST_ATTR;
-  }
-  
-  // Get memory and time requirements from xml root element 'test'
-  auto rootOpt = pt.get_child_optional("test");
-  if (!rootOpt)
-  {
-    LOG("Bad config.xml file, there should be root element named 'test'.", grader::ERROR);
-    return INVALID_TEST_ATTR;
-  }
-  auto root = *rootOpt;
-  size_t memoryBytes = root.get<size_t>("<xmlattr>.memory", 0);
-  size_t timeMilliseconds = root.get<size_t>("<xmlattr>.time", 0);
-  string language = root.get<string>("<xmlattr>.language", "");
-  if (0 == memoryBytes)
-  {
-    LOG("No memory constraint as attribute in 'test' element.", grader::ERROR);
-    return INVALID_TEST_ATTR;
-  }
-  if (0 == timeMilliseconds)
-  {
-    LOG("No time constraint as attribute in 'test' element.", grader::ERROR);
-    return INVALID_TEST_ATTR;
-  }
-  if ("" == language)
-  {
-    LOG("No programming language specified as attribute in 'test' element.", grader::ERROR);
-    return INVALID_TEST_ATTR;
+    return false;
   }
   
-  // Traverse through property tree 
-  auto treeItBegin = root.begin();
-  auto treeItEnd = root.end();
-  while (treeItBegin != treeItEnd)
+  // Every thread takes next test that nobody started yet and stores result on test's index,
+  // test waits for one of slots shared by all workers before it starts (see test_slots)
+  atomic<size_t> nextTest(0);
+  auto worker = [&]()
   {
-    // Skip attributes of test
-    if ("<xmlattr>" == treeItBegin->first)
-    {
-      ++treeItBegin;
-      continue;
-    }
-      
-    // Handle input
-    if ("input" != treeItBegin->first)
+    for (size_t i = nextTest++; i < tests.size(); i = nextTest++)
     {
-      LOG("Invalid xml format! Expected 'input'!", grader::ERROR);
-      return INVALID_TEST_ATTR;
-    }
-    else 
-    {
-      // Get input test
-      subtest in = subtest(subtest::subtest_in, treeItBegin->second.data(), 
-                        subtest::io_from_str(treeItBegin->second.get<string>("<xmlattr>.type", "std")),
-                        treeItBegin->second.get("<xmlattr>.path", ""));
-      
-      // Advance to next xml element
-      ++treeItBegin;
-      if (treeItBegin == treeItEnd)
+      // Exception must not leave test thread, that would terminate whole worker
+      try 
       {
-        LOG("Invalid xml format! Expected 'output' element after 'input'!", grader::ERROR);
-        return INVALID_TEST_ATTR;
+        test_slots::guard slot;
+        testResults[i] = graderObj.run_test(tests[i], i);
+      } 
+      catch (const exception& e) 
+      {
+        stringstream logmsg;
+        logmsg << "Exception raised while running test: " << i
+               << " Error message: " << e.what()
+               << " Task id: " << m_id;
+        LOG(logmsg.str(), grader::ERROR);
+        testResults[i] = test_report{};
       }
-      if ("output" != treeItBegin->first)
+      catch (...)
       {
-        LOG("Invalid xml format! Expected 'output' element!", grader::ERROR);
-        return INVALID_TEST_ATTR; 
+        stringstream logmsg;
+        logmsg << "Unknown exception raised while running test: " << i << " Task id: " << m_id;
+        LOG(logmsg.str(), grader::ERROR);
+        testResults[i] = test_report{};
       }
       
-      // Get output test, add new element to tests vector and advance in tree
-      subtest out = subtest(subtest::subtest_out, treeItBegin->second.data(),
-                      subtest::io_from_str(treeItBegin->second.get<string>("<xmlattr>.type", "std")),
-                      treeItBegin->second.get("<xmlattr>.path", ""));
-      tests.emplace_back(move(in), move(out));
+      // Stream clients get result of test as soon as it's known
+      publish_test_result(i, testResults[i]);
     }
-    ++treeItBegin;
-  }
+  };
   
-  return move(make_tuple(memoryBytes, timeMilliseconds, language));
+  size_t threadsCount = parallelism();
+  vector<thread> threads;
+  threads.reserve(threadsCount);
+  for (size_t i = 1; i < threadsCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads)
+    t.join();
+  return true;
 }
 
 void task::terminate_handler()
 {
+  // Stack of test thread isn't the one state was saved on, process just dies (task_reaper ends task as invalid)
+  if (this_thread::get_id() != g_saveStateThread)
+  {
+    LOG("Terminate called on test thread! Terminating task process...", grader::FATAL);
+    abort();
+  }
   longjmp(g_saveStateBeforeTerminate, 1);
 }
 
 void task::set_state(task::state newState)
 {
-  boost::interprocess::scoped_lock<mutex_type> lock(s_lock);
-  m_state = newState;
+  // Run that is about to end stops accepting followers first, after that list of followers doesn't change
+  if (is_terminal(newState) && '\0' != m_fingerprint[0])
+  {
+    inflight_runs::instance().leave(m_fingerprint, m_id);
+    m_fingerprint[0] = '\0';
+  }
+  
+  // Followers get every state (final status included) before this task does, it can be destroyed right after
+  vector<string> followers;
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    for (const auto& f : m_followers)
+      followers.emplace_back(f.id);
+  }
+  for (const auto& followerId : followers)
+  {
+    // Follower that reached final state can be deleted right away, guard keeps it until we are done with it
+    epoch_manager::guard readGuard;
+    auto follower = find(followerId.c_str());
+    if (!follower)
+      continue;
+    if (state::FINISHED == newState || state::COMPILE_ERROR == newState)
+      follower->m_status = m_status;
+    follower->set_state(newState);
+  }
+  
+  // Task that reached final state keeps only what clients read, status is shrunk before it's published
+  if (is_terminal(newState))
+    compact();
+  
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  if (is_terminal(newState))
+    m_finishedAt.store(time(nullptr));
+  m_state.store(newState, memory_order_release);
+  append_event(status_of(newState));
+  m_stateChanged.notify_all();
+}
+
+void task::compact()
+{
+  // Status of task that is already in final state is read without lock, it must stay as it is
+  if (is_terminal(m_state.load(memory_order_acquire)))
+    return;
+  
+  // Source and reference to tests go back to segment (suite is destroyed with its last task)
+  shm_string(m_fileContent.get_allocator()).swap(m_fileContent);
+  if (m_suite)
+  {
+    test_suite::release(m_suite.get());
+    m_suite = nullptr;
+  }
+  m_status.shrink_to_fit();
+  
+  // Followers already got final state, run left inflight_runs so nobody attaches anymore
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  shm_follower_vector(m_followers.get_allocator()).swap(m_followers);
+}
+
+void task::reject()
+{
+  // Followers that attached in the meantime (or that follow run of dead worker) end together with this task
+  set_state(state::INVALID);
+}
+
+string task::fingerprint() const
+{
+  // Tests document hash carries language and limits, task that bypasses cache never shares run served from it
+  sha1_hasher hasher;
+  hasher.update(m_bypassCache ? "fresh" : "cached");
+  hasher.update(m_suite->hash(), strlen(m_suite->hash()) + 1).update(m_fileName.c_str(), m_fileName.size() + 1);
+  return hasher.update(m_fileContent.data(), m_fileContent.size()).hex_digest();
+}
+
+bool task::add_follower(task* follower)
+{
+  // Run that ended (or is ending) can't share its result anymore
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  if (is_terminal(m_state))
+    return false;
+  m_followers.emplace_back();
+  strncpy(m_followers.back().id, follower->id(), sizeof(m_followers.back().id) - 1);
+  m_followers.back().id[sizeof(m_followers.back().id) - 1] = '\0';
+  
+  // Follower catches up with state and events run already published, later ones are forwarded by
+  // set_state and publish_events (status of state that isn't final comes from state alone)
+  boost::interprocess::scoped_lock<mutex_type> followerLock(follower->m_lock);
+  follower->m_state.store(m_state.load(), memory_order_release);
+  follower->m_events.append(m_events.begin(), m_events.end());
+  follower->m_stateChanged.notify_all();
+  return true;
+}
+
+void task::lead(const char* fingerprint)
+{
+  strncpy(m_fingerprint, fingerprint, sizeof(m_fingerprint) - 1);
+  m_fingerprint[sizeof(m_fingerprint) - 1] = '\0';
+}
+
+void task::publish_test_result(size_t testNo, const test_report& report)
+{
+  publish_events(test_event(testNo, report));
+}
+
+void task::publish_events(const string& events)
+{
+  // Followers are locked under this task's lock, so they get events in same order as this task
+  if (events.empty())
+    return;
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  m_events.append(events.c_str(), events.size());
+  m_stateChanged.notify_all();
+  epoch_manager::guard readGuard;
+  for (const auto& f : m_followers)
+  {
+    auto follower = find(f.id);
+    if (!follower)
+      continue;
+    boost::interprocess::scoped_lock<mutex_type> followerLock(follower->m_lock);
+    follower->m_events.append(events.c_str(), events.size());
+    follower->m_stateChanged.notify_all();
+  }
+}
+
+void task::append_event(const char* json)
+{
+  m_events.append(json);
+  m_events.push_back(EVENT_SEPARATOR);
+}
+
+bool task::read_events(size_t& offset, string& events, unsigned timeoutMS) const
+{
+  // Wait for events that reader didn't see yet, log is complete when task reaches terminal state
+  using namespace boost::posix_time;
+  auto deadline = microsec_clock::universal_time() + milliseconds(timeoutMS);
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  ++m_waiters;
+  while (m_events.size() <= offset && !is_terminal(m_state))
+  {
+    if (!m_stateChanged.timed_wait(lock, deadline))
+      break;
+  }
+  --m_waiters;
+  
+  if (m_events.size() > offset)
+  {
+    events.append(m_events.begin() + offset, m_events.end());
+    offset = m_events.size();
+  }
+  return !is_terminal(m_state);
 }
 
 task::state task::get_state() const
 {
-  boost::interprocess::scoped_lock<mutex_type> lock(s_lock);
+  return m_state.load(memory_order_acquire);
+}
+
+task::state task::wait_for_change(task::state seen, unsigned timeoutMS) const
+{
+  // Terminal states never change, so nobody waits on them (and finished task can be safely destroyed)
+  using namespace boost::posix_time;
+  auto deadline = microsec_clock::universal_time() + milliseconds(timeoutMS);
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  ++m_waiters;
+  while (seen == m_state && !is_terminal(m_state))
+  {
+    if (!m_stateChanged.timed_wait(lock, deadline))
+      break;
+  }
+  --m_waiters;
   return m_state;
 }
+
+bool task::has_waiters() const
+{
+  boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+  return 0 != m_waiters;
+}
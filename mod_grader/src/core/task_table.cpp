@@ -0,0 +1,211 @@
+// Project headers
+#include "task_table.hpp"
+#include "task.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+// BOOST headers
+#include <boost/interprocess/sync/scoped_lock.hpp>
+
+// Linux headers
+#include <sys/random.h>
+
+using namespace std;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Task table slots must be lock free to live in shared memory");
+
+namespace
+{
+  const char* HEX_DIGITS = "0123456789abcdef";
+
+  // Parses fixed number of lowercase hex digits (ids are always formatted with all digits)
+  template <typename T>
+  bool parse_hex(const char* str, size_t digits, T& value)
+  {
+    value = 0;
+    for (size_t i = 0; i < digits; ++i)
+    {
+      char c = str[i];
+      unsigned digit;
+      if ('0' <= c && c <= '9')
+        digit = c - '0';
+      else if ('a' <= c && c <= 'f')
+        digit = c - 'a' + 10;
+      else
+        return false;
+      value = static_cast<T>((value << 4) | digit);
+    }
+    return true;
+  }
+
+  // Every nonce comes from kernel CSPRNG, so seeing any number of ids tells nothing about next one
+  bool random_nonce(uint64_t& nonce)
+  {
+    ssize_t got;
+    do
+    {
+      got = getrandom(&nonce, sizeof(nonce), 0);
+    } while (-1 == got && EINTR == errno);
+    if (static_cast<ssize_t>(sizeof(nonce)) == got)
+      return true;
+
+    stringstream logmsg;
+    logmsg << "Couldn't get random nonce for task id. Error message: " << strerror(errno);
+    LOG(logmsg.str(), grader::ERROR);
+    return false;
+  }
+
+  template <typename T>
+  void format_hex(T value, size_t digits, char* str)
+  {
+    for (size_t i = digits; i > 0; --i)
+    {
+      str[i - 1] = HEX_DIGITS[value & 0xf];
+      value >>= 4;
+    }
+  }
+}
+
+namespace grader
+{
+  const char* task_table::SHM_NAME = "grader_task_table";
+  constexpr size_t task_table::ID_LENGTH;
+  constexpr size_t task_table::DEFAULT_CAPACITY;
+
+  task_table::task_table(size_t capacity)
+  : m_slots(shm().construct<slot>(boost::interprocess::anonymous_instance)[capacity]()), m_capacity(capacity),
+    m_free(shm().get_segment_manager())
+  {
+    // Lower slots are handed out first
+    m_free.reserve(capacity);
+    for (size_t i = capacity; i > 0; --i)
+      m_free.push_back(static_cast<uint32_t>(i - 1));
+  }
+
+  task_table& task_table::instance()
+  {
+    // Read capacity from configuration (used only by process that constructs table)
+    static task_table* table = []()
+    {
+      size_t capacity = configuration::instance().get_number(configuration::MAX_TASKS, DEFAULT_CAPACITY);
+      capacity = max<size_t>(min<size_t>(capacity, UINT32_MAX), 1);
+      return shm().find_or_construct<task_table>(SHM_NAME)(capacity);
+    }();
+    return *table;
+  }
+
+  bool task_table::reserve(char* id)
+  {
+    handle h;
+    if (!random_nonce(h.nonce))
+      return false;
+
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    if (m_free.empty())
+      return false;
+
+    h.slot = m_free.back();
+    m_free.pop_back();
+    slot& s = m_slots[h.slot];
+    h.generation = s.generation.load(memory_order_relaxed) + 1;
+    s.nonce.store(h.nonce, memory_order_relaxed);
+    s.generation.store(h.generation, memory_order_release);
+    format(h, id);
+    return true;
+  }
+
+  void task_table::publish(const char* id, task* t)
+  {
+    handle h;
+    slot* s = const_cast<slot*>(slot_of(id, h));
+    if (s)
+      s->task.store(shm().get_handle_from_address(t), memory_order_release);
+  }
+
+  bool task_table::release(const char* id)
+  {
+    // Id of released task can't find anything anymore, even after slot is reused (only one releaser succeeds)
+    handle h;
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    slot* s = const_cast<slot*>(slot_of(id, h));
+    if (!s)
+      return false;
+    s->task.store(0, memory_order_relaxed);
+    s->generation.store(h.generation + 1, memory_order_release);
+    m_free.push_back(h.slot);
+    return true;
+  }
+
+  task* task_table::find(const char* id) const
+  {
+    // Generation is read before and after handle, so handle belongs to task with this id
+    handle h;
+    const slot* s = slot_of(id, h);
+    if (!s)
+      return nullptr;
+    auto taskHandle = s->task.load(memory_order_acquire);
+    if (0 == taskHandle || h.generation != s->generation.load(memory_order_acquire))
+      return nullptr;
+    return static_cast<task*>(shm().get_address_from_handle(taskHandle));
+  }
+
+  void task_table::for_each(const function<void(const char*, task*)>& visit) const
+  {
+    // Slot that changes while it's read is skipped (its task was just added or removed)
+    char id[ID_LENGTH + 1];
+    for (size_t i = 0; i < m_capacity; ++i)
+    {
+      const slot& s = m_slots[i];
+      handle h;
+      h.slot = static_cast<uint32_t>(i);
+      h.generation = s.generation.load(memory_order_acquire);
+      if (0 == h.generation % 2)
+        continue;
+      h.nonce = s.nonce.load(memory_order_relaxed);
+      auto taskHandle = s.task.load(memory_order_acquire);
+      if (0 == taskHandle || h.generation != s.generation.load(memory_order_acquire))
+        continue;
+      format(h, id);
+      visit(id, static_cast<task*>(shm().get_address_from_handle(taskHandle)));
+    }
+  }
+
+  size_t task_table::size()
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    return m_capacity - m_free.size();
+  }
+
+  const task_table::slot* task_table::slot_of(const char* id, handle& h) const
+  {
+    if (!parse(id, h) || h.slot >= m_capacity || 0 == h.generation % 2)
+      return nullptr;
+    const slot& s = m_slots[h.slot];
+    if (h.generation != s.generation.load(memory_order_acquire) || h.nonce != s.nonce.load(memory_order_relaxed))
+      return nullptr;
+    return &s;
+  }
+
+  bool task_table::parse(const char* id, handle& h)
+  {
+    // Exactly ID_LENGTH lowercase hex digits, nothing before or after them
+    return ID_LENGTH == strlen(id) && parse_hex(id, 8, h.slot) && parse_hex(id + 8, 8, h.generation) &&
+           parse_hex(id + 16, 16, h.nonce);
+  }
+
+  void task_table::format(const handle& h, char* id)
+  {
+    format_hex(h.slot, 8, id);
+    format_hex(h.generation, 8, id + 8);
+    format_hex(h.nonce, 16, id + 16);
+    id[ID_LENGTH] = '\0';
+  }
+}
@@ -0,0 +1,189 @@
+// Project headers
+#include "test_generator.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+#include "hash.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+// BOOST headers
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// POCO headers
+#include <Poco/Pipe.h>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+namespace fs = boost::filesystem;
+
+namespace grader
+{
+  constexpr size_t test_generator::DEFAULT_TIME_MS;
+  constexpr size_t test_generator::MAX_OUTPUT_SIZE;
+  const char* test_generator::SHM_COUNTERS_NAME = "grader_generator_cache_counters";
+
+  test_generator::test_generator()
+  : m_files("generator cache", SHM_COUNTERS_NAME, configuration::GENERATOR_CACHE_DIR,
+            configuration::GENERATOR_CACHE_SIZE, DEFAULT_SIZE),
+    m_timeMS(DEFAULT_TIME_MS)
+  {
+    const configuration& conf = configuration::instance();
+    auto programDirIt = conf.get(configuration::GENERATOR_DIR);
+    if (conf.invalid() == programDirIt || programDirIt->second.empty())
+      return;
+
+    m_timeMS = conf.get_number(configuration::GENERATOR_TIME_MS, DEFAULT_TIME_MS);
+
+    // Programs run next to task directories, system temporary directory is used without them
+    auto baseDirIt = conf.get(configuration::BASE_DIR);
+    boost::system::error_code code;
+    m_scratchDir = conf.invalid() != baseDirIt && !baseDirIt->second.empty() ? baseDirIt->second
+                                                                               : fs::temp_directory_path(code).string();
+    m_programDir = programDirIt->second;
+  }
+
+  test_generator& test_generator::instance()
+  {
+    static test_generator generator;
+    return generator;
+  }
+
+  bool test_generator::generate(const string& generator, const string& seed, const string& args, string& outputPath)
+  {
+    string hash;
+    if (!program_hash(generator, hash))
+      return false;
+
+    // Seed is first argument, extra arguments are split on white space (no shell involved)
+    stringstream argsStream(args);
+    vector<string> argv{seed};
+    argv.insert(argv.end(), istream_iterator<string>(argsStream), istream_iterator<string>());
+    sha1_hasher hasher;
+    hasher.update("gen").update(hash);
+    for (const auto& arg : argv)
+      hasher.update(arg.c_str(), arg.size() + 1);
+    return run(generator, hasher.hex_digest(), argv, nullptr, 0, outputPath);
+  }
+
+  bool test_generator::solve(const string& solution, const char* input, size_t inputLen, string& outputPath)
+  {
+    string hash;
+    if (!program_hash(solution, hash))
+      return false;
+
+    sha1_hasher hasher;
+    hasher.update("ref").update(hash).update(&inputLen, sizeof(inputLen)).update(input, inputLen);
+    return run(solution, hasher.hex_digest(), vector<string>(), input, inputLen, outputPath);
+  }
+
+  bool test_generator::run(const string& program, const string& key, const vector<string>& args,
+                           const char* input, size_t inputLen, string& outputPath)
+  {
+    // Output was already produced by this or other worker
+    auto entry = m_files.entry_path(key);
+    boost::system::error_code code;
+    if (fs::is_regular_file(entry, code))
+    {
+      m_files.touch(key);
+      m_files.hit();
+      outputPath = entry;
+      return true;
+    }
+    m_files.miss();
+
+    // Program gets empty scratch directory, so whatever it leaves behind is removed with it
+    auto scratchDir = m_scratchDir + "/gen_" + key + "_" + to_string(getpid());
+    fs::create_directories(scratchDir, code);
+    if (boost::system::errc::success != code)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't create directory for test generating program: " << scratchDir << " Message: " << code.message();
+      LOG(logmsg.str(), grader::ERROR);
+      return false;
+    }
+
+    // Output is written under temporary name of cache entry and committed when program succeeds
+    bool success = false;
+    {
+      ofstream out(m_files.tmp_path(key), ios::binary | ios::trunc);
+      size_t written = 0;
+      Poco::Pipe inPipe;
+      Poco::Pipe outPipe;
+      process_limits limits;
+      limits.cpuTimeMS = m_timeMS;
+      limits.wallTimeMS = 2 * m_timeMS;
+      try
+      {
+        auto ph = launch_process(program_path(program), args, scratchDir, input ? &inPipe : nullptr, &outPipe, nullptr, limits);
+        ph.communicate(input ? &inPipe : nullptr, input, inputLen, &outPipe,
+                       [&out, &written](const char* data, size_t len)
+                       {
+                         written += len;
+                         return written <= MAX_OUTPUT_SIZE && out.write(data, len);
+                       });
+        const process_status& status = ph.wait();
+        out.close();
+        success = status.success() && written <= MAX_OUTPUT_SIZE && out;
+        if (!success)
+        {
+          stringstream logmsg;
+          logmsg << "Test generating program failed: " << program << " Exit code: " << status.exitCode
+                 << " Signal: " << status.signal << " Time limit exceeded: " << status.limit_exceeded()
+                 << " Output bytes: " << written;
+          LOG(logmsg.str(), grader::ERROR);
+        }
+      }
+      catch (const exception& e)
+      {
+        stringstream logmsg;
+        logmsg << "Couldn't start test generating program: " << program_path(program) << " Error message: " << e.what();
+        LOG(logmsg.str(), grader::ERROR);
+      }
+    }
+    fs::remove_all(scratchDir, code);
+
+    if (!m_files.commit(key, success))
+      return false;
+    outputPath = entry;
+    return true;
+  }
+
+  bool test_generator::program_hash(const string& program, string& hash) const
+  {
+    // Tests document can name only programs installed in generator directory
+    if (!enabled())
+    {
+      LOG("Tests document uses generated tests, but GENERATOR_DIR or GENERATOR_CACHE_DIR isn't configured.", grader::ERROR);
+      return false;
+    }
+    if (program.empty() || "." == program || ".." == program || string::npos != program.find('/'))
+    {
+      stringstream logmsg;
+      logmsg << "Invalid name of test generating program: " << program;
+      LOG(logmsg.str(), grader::ERROR);
+      return false;
+    }
+
+    // Output is cached by content of program, so replaced program doesn't serve stale tests
+    try
+    {
+      boost::iostreams::mapped_file_source file(program_path(program));
+      hash = sha1_hasher().update(file.data(), file.size()).hex_digest();
+    }
+    catch (const exception& e)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't read test generating program: " << program_path(program) << " Error message: " << e.what();
+      LOG(logmsg.str(), grader::ERROR);
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,86 @@
+// Project headers
+#include "test_slots.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// BOOST headers
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Test slots must be lock free to live in shared memory");
+
+namespace grader
+{
+  const char* test_slots::SHM_NAME = "grader_test_slots";
+  constexpr size_t test_slots::MAX_SLOTS;
+  constexpr unsigned test_slots::DEAD_OWNER_CHECK_MS;
+
+  test_slots::guard::guard()
+  : m_slot(instance().acquire())
+  {
+  }
+
+  test_slots::guard::~guard()
+  {
+    instance().release(m_slot);
+  }
+
+  test_slots::test_slots(size_t capacity)
+  : m_capacity(max<size_t>(min(capacity, MAX_SLOTS), 1))
+  {
+  }
+
+  test_slots& test_slots::instance()
+  {
+    // Read capacity from configuration (used only by process that constructs slots)
+    static test_slots* slots = []()
+    {
+      // Number of cores when it isn't configured
+      size_t capacity = configuration::instance().get_number(configuration::MAX_PARALLEL_TESTS,
+                                                             max(thread::hardware_concurrency(), 1U));
+      return shm().find_or_construct<test_slots>(SHM_NAME)(capacity);
+    }();
+    return *slots;
+  }
+
+  test_slots::slot* test_slots::acquire()
+  {
+    // Nobody frees slot of process that died, so waiting wakes up now and then to look for such slots
+    using namespace boost::posix_time;
+    auto pid = getpid();
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    while (true)
+    {
+      for (size_t i = 0; i < m_capacity; ++i)
+      {
+        slot& s = m_slots[i];
+        int owner = s.owner.load();
+        if (0 == owner || is_dead(owner))
+        {
+          s.owner.store(pid);
+          return &s;
+        }
+      }
+      m_freed.timed_wait(lock, microsec_clock::universal_time() + milliseconds(DEAD_OWNER_CHECK_MS));
+    }
+  }
+
+  void test_slots::release(slot* s)
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    s->owner.store(0);
+    m_freed.notify_one();
+  }
+}
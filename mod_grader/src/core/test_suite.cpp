@@ -0,0 +1,554 @@
+// Project headers
+#include "test_suite.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+#include "hash.hpp"
+#include "suite_file.hpp"
+#include "test_generator.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// BOOST headers
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+// Linux headers
+#include <unistd.h>
+
+using namespace std;
+using namespace grader;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_CHAR_LOCK_FREE == 2, "Suite state must be lock free to live in shared memory");
+
+namespace
+{
+  // Subtest whose content is produced on grader (generator output for input, reference solution output for output)
+  struct generated_subtest
+  {
+    size_t testNo;
+    subtest::subtest_type type;
+    string program;
+    string seed;
+    string args;
+  };
+
+  // Parses tests document into property tree, returned views point into tree (expected outputs are trimmed in place)
+  bool parse(const char* testsContent, size_t testsCLen, boost::property_tree::ptree& pt, vector<test_view>& tests,
+             vector<generated_subtest>& generated, size_t& memoryBytes, size_t& timeMS, string& language, size_t& parallelism)
+  {
+    // Read xml into property tree
+    using namespace boost::property_tree;
+    istringstream testsInput(string(testsContent, testsContent + testsCLen));
+    try
+    {
+      xml_parser::read_xml(testsInput, pt, xml_parser::no_comments);
+    }
+    catch (const xml_parser::xml_parser_error& e)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't parse tests content (check if tests are xml valid). "
+             << "Error message: " << e.what();
+      LOG(logmsg.str(), grader::ERROR);
+      return false;
+    }
+
+    // Get memory and time requirements from xml root element 'test'
+    auto rootOpt = pt.get_child_optional("test");
+    if (!rootOpt)
+    {
+      LOG("Bad config.xml file, there should be root element named 'test'.", grader::ERROR);
+      return false;
+    }
+    auto& root = *rootOpt;
+    memoryBytes = root.get<size_t>("<xmlattr>.memory", 0);
+    timeMS = root.get<size_t>("<xmlattr>.time", 0);
+    language = root.get<string>("<xmlattr>.language", "");
+    parallelism = root.get<size_t>("<xmlattr>.parallel", 0);
+    if (0 == memoryBytes)
+    {
+      LOG("No memory constraint as attribute in 'test' element.", grader::ERROR);
+      return false;
+    }
+    if (0 == timeMS)
+    {
+      LOG("No time constraint as attribute in 'test' element.", grader::ERROR);
+      return false;
+    }
+    if ("" == language)
+    {
+      LOG("No programming language specified as attribute in 'test' element.", grader::ERROR);
+      return false;
+    }
+
+    // Traverse through property tree, generated subtest is fed through file when it has path and through standard I/O otherwise
+    auto view = [&tests, &generated](ptree& node, subtest::subtest_type type, const checker_spec& checker)
+    {
+      auto pathNode = node.get_child_optional("<xmlattr>.path");
+      byte_span path = pathNode ? byte_span(pathNode->data().data(), pathNode->data().size()) : byte_span();
+      auto ioStr = node.get<string>("<xmlattr>.type", "std");
+      if ((subtest::subtest_in == type && "gen" == ioStr) || (subtest::subtest_out == type && "ref" == ioStr))
+      {
+        auto program = node.get<string>(subtest::subtest_in == type ? "<xmlattr>.generator" : "<xmlattr>.solution", "");
+        generated.push_back(generated_subtest{tests.size(), type, program, node.get<string>("<xmlattr>.seed", ""), node.data()});
+        return subtest_view(pathNode ? subtest::subtest_i_o::FILE : subtest::subtest_i_o::STD, checker, byte_span(), path);
+      }
+      return subtest_view(subtest::io_from_str(ioStr), checker, byte_span(node.data().data(), node.data().size()), path);
+    };
+    auto treeItBegin = root.begin();
+    auto treeItEnd = root.end();
+    while (treeItBegin != treeItEnd)
+    {
+      // Skip attributes of test
+      if ("<xmlattr>" == treeItBegin->first)
+      {
+        ++treeItBegin;
+        continue;
+      }
+
+      // Handle input
+      if ("input" != treeItBegin->first)
+      {
+        LOG("Invalid xml format! Expected 'input'!", grader::ERROR);
+        return false;
+      }
+      else
+      {
+        // Get input test
+        subtest_view in = view(treeItBegin->second, subtest::subtest_in, checker_spec());
+
+        // Advance to next xml element
+        ++treeItBegin;
+        if (treeItBegin == treeItEnd)
+        {
+          LOG("Invalid xml format! Expected 'output' element after 'input'!", grader::ERROR);
+          return false;
+        }
+        if ("output" != treeItBegin->first)
+        {
+          LOG("Invalid xml format! Expected 'output' element!", grader::ERROR);
+          return false;
+        }
+
+        // Get output test (trimmed once here, so it's stored trimmed) and add new element to tests
+        boost::trim(treeItBegin->second.data());
+        subtest_view out = view(treeItBegin->second, subtest::subtest_out,
+                                checker_spec::from_str(treeItBegin->second.get<string>("<xmlattr>.checker", "exact")));
+        tests.emplace_back(in, out);
+      }
+      ++treeItBegin;
+    }
+    return true;
+  }
+
+  // Folds content of every program that produces tests into hash of tests document
+  bool programs_hash(const vector<generated_subtest>& generated, string& hash)
+  {
+    const test_generator& generator = test_generator::instance();
+    set<pair<subtest::subtest_type, string>> programs;
+    for (const auto& g : generated)
+      programs.emplace(g.type, g.program);
+
+    sha1_hasher hasher;
+    hasher.update(hash);
+    for (const auto& program : programs)
+    {
+      string programHash;
+      if (!generator.program_hash(program.second, programHash))
+        return false;
+      hasher.update(subtest::subtest_in == program.first ? "gen" : "ref");
+      hasher.update(program.second.c_str(), program.second.size() + 1).update(programHash);
+    }
+    hash = hasher.hex_digest();
+    return true;
+  }
+
+  // Replaces content of generated subtests with mapped output of their programs (inputs first, reference solutions read them)
+  bool generate(const vector<generated_subtest>& generated, vector<test_view>& tests,
+                vector<boost::iostreams::mapped_file_source>& outputs)
+  {
+    test_generator& generator = test_generator::instance();
+    for (auto type : { subtest::subtest_in, subtest::subtest_out })
+    {
+      for (const auto& g : generated)
+      {
+        if (type != g.type)
+          continue;
+        subtest_view& view = subtest::subtest_in == type ? tests[g.testNo].first : tests[g.testNo].second;
+        const byte_span& input = tests[g.testNo].first.content();
+        string outputPath;
+        if (subtest::subtest_in == type ? !generator.generate(g.program, g.seed, g.args, outputPath)
+                                        : !generator.solve(g.program, input.data(), input.size(), outputPath))
+          return false;
+
+        // Empty file can't be mapped, expected output is trimmed by moving ends of view (mapping is read-only)
+        byte_span content;
+        try
+        {
+          if (0 != boost::filesystem::file_size(outputPath))
+          {
+            outputs.emplace_back(outputPath);
+            content = byte_span(outputs.back().data(), outputs.back().size());
+          }
+        }
+        catch (const exception& e)
+        {
+          stringstream logmsg;
+          logmsg << "Couldn't map generated test: " << outputPath << " Error message: " << e.what();
+          LOG(logmsg.str(), grader::ERROR);
+          return false;
+        }
+        if (subtest::subtest_out == type)
+        {
+          auto isSpace = [](char c) { return isspace(static_cast<unsigned char>(c)); };
+          auto begin = find_if_not(content.begin(), content.end(), isSpace);
+          auto end = find_if_not(reverse_iterator<const char*>(content.end()), reverse_iterator<const char*>(begin), isSpace).base();
+          content = byte_span(begin, end - begin);
+        }
+        view = subtest_view(view.io(), view.checker(), content, view.path());
+      }
+    }
+    return true;
+  }
+}
+
+namespace grader
+{
+  const char* test_suite::SHM_NAME_PREFIX = "suite-";
+  constexpr unsigned test_suite::GENERATOR_CHECK_MS;
+
+  test_suite::test_suite(shm_test_vector&& tests, const string& file, size_t size, size_t memoryBytes, size_t timeMS,
+                         const string& language, size_t parallelism, const string& hash, const string& document)
+  : m_tests(boost::move(tests)), m_file(file.c_str(), shm().get_segment_manager()), m_size(size), m_memoryBytes(memoryBytes), m_timeMS(timeMS), m_parallelism(parallelism), m_refs(1), m_registered(false),
+  m_document(document.c_str(), document.size(), shm().get_segment_manager()), m_state(document.empty() ? state::READY : state::PENDING),
+  m_generator(0)
+  {
+    auto languageLen = min(language.size(), sizeof(m_language) - 1);
+    copy_n(language.cbegin(), languageLen, m_language);
+    m_language[languageLen] = '\0';
+
+    auto hashLen = min(hash.size(), sizeof(m_hash) - 1);
+    copy_n(hash.cbegin(), hashLen, m_hash);
+    m_hash[hashLen] = '\0';
+  }
+
+  test_suite* test_suite::create(const char* testsContent, size_t testsCLen)
+  {
+    // Same document was already parsed, share it
+    auto hash = sha1_hasher().update(testsContent, testsCLen).hex_digest();
+    auto suite = acquire(hash.c_str());
+    if (suite)
+      return suite;
+
+    // Parse without holding segment lock
+    boost::property_tree::ptree pt;
+    vector<test_view> views;
+    vector<generated_subtest> generated;
+    size_t memoryBytes, timeMS, parallelism;
+    string language;
+    if (!parse(testsContent, testsCLen, pt, views, generated, memoryBytes, timeMS, language, parallelism))
+      return nullptr;
+
+    // Suite with generated tests is found by content of its programs too, so rebuilt program gives new suite
+    // (and new result cache keys), such documents don't carry test data so parsing them again is cheap
+    if (!generated.empty())
+    {
+      if (!programs_hash(generated, hash))
+        return nullptr;
+      suite = acquire(hash.c_str());
+      if (suite)
+        return suite;
+    }
+
+    // Generated tests are produced later by worker (see prepare), until then suite keeps only its document
+    shm_test_vector tests(shm().get_segment_manager());
+    string file, document;
+    if (generated.empty())
+    {
+      if (!store_tests(views, hash, memoryBytes, timeMS, language, parallelism, tests, file))
+        return nullptr;
+    }
+    else
+      document.assign(testsContent, testsCLen);
+
+    // Other request could parse same document in the meantime, then our copy is just dropped
+    auto name = shm_name(hash);
+    bool constructed = false;
+    auto findOrConstruct = [&]()
+    {
+      auto found = shm().find_no_lock<test_suite>(name.c_str());
+      if (0 != found.second)
+      {
+        suite = found.first;
+        ++suite->m_refs;
+      }
+      else
+      {
+        suite = shm().construct<test_suite>(name.c_str())(boost::move(tests), file, views.size(), memoryBytes, timeMS,
+                                                          language, parallelism, hash, document);
+        constructed = true;
+      }
+    };
+    try
+    {
+      shm().atomic_func(findOrConstruct);
+    }
+    catch (const exception& e)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't construct suite in shared memory. Error message: " << e.what();
+      LOG(logmsg.str(), grader::ERROR);
+      suite = nullptr;
+    }
+    if (!constructed && !file.empty())
+    {
+      boost::system::error_code code;
+      boost::filesystem::remove(file, code);
+    }
+    return suite;
+  }
+
+  bool test_suite::prepare()
+  {
+    // One worker produces tests, others wait for it (or take over when it died)
+    auto pid = getpid();
+    while (true)
+    {
+      auto s = m_state.load();
+      if (state::PENDING != s)
+        return state::READY == s;
+      int generator = m_generator.load();
+      if ((0 == generator || is_dead(generator)) && m_generator.compare_exchange_strong(generator, pid))
+        break;
+      this_thread::sleep_for(chrono::milliseconds(GENERATOR_CHECK_MS));
+    }
+    if (state::PENDING != m_state.load())
+    {
+      m_generator.store(0);
+      return state::READY == m_state.load();
+    }
+
+    // Document is parsed again, it's small since it doesn't carry generated test data
+    boost::property_tree::ptree pt;
+    vector<test_view> views;
+    vector<generated_subtest> generated;
+    size_t memoryBytes, timeMS, parallelism;
+    string language;
+    vector<boost::iostreams::mapped_file_source> generatedOutputs;
+    shm_test_vector tests(shm().get_segment_manager());
+    string file;
+    bool success = parse(m_document.c_str(), m_document.size(), pt, views, generated, memoryBytes, timeMS, language, parallelism)
+                   && generate(generated, views, generatedOutputs)
+                   && store_tests(views, m_hash, memoryBytes, timeMS, language, parallelism, tests, file);
+    if (success)
+    {
+      try
+      {
+        m_file = file.c_str();
+        m_tests = boost::move(tests);
+        shm_string(m_document.get_allocator()).swap(m_document);
+      }
+      catch (const exception& e)
+      {
+        stringstream logmsg;
+        logmsg << "Couldn't store generated tests of suite: " << m_hash << " Error message: " << e.what();
+        LOG(logmsg.str(), grader::ERROR);
+        success = false;
+      }
+    }
+    if (!success)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't produce generated tests of suite: " << m_hash << " Suite is invalid.";
+      LOG(logmsg.str(), grader::ERROR);
+      if (!file.empty())
+      {
+        boost::system::error_code code;
+        boost::filesystem::remove(file, code);
+      }
+    }
+    m_state.store(success ? state::READY : state::INVALID);
+    m_generator.store(0);
+    return success;
+  }
+
+  test_suite* test_suite::acquire(const char* hash)
+  {
+    auto name = shm_name(hash);
+    test_suite* suite = nullptr;
+    auto findAndAcquire = [&]()
+    {
+      auto found = shm().find_no_lock<test_suite>(name.c_str());
+      if (0 != found.second)
+      {
+        suite = found.first;
+        ++suite->m_refs;
+      }
+    };
+    shm().atomic_func(findAndAcquire);
+    return suite;
+  }
+
+  void test_suite::acquire(test_suite* suite)
+  {
+    auto increment = [suite]() { ++suite->m_refs; };
+    shm().atomic_func(increment);
+  }
+
+  void test_suite::release(test_suite* suite)
+  {
+    // Segment lock is recursive, so suite can be destroyed while it's held
+    auto decrement = [suite]()
+    {
+      if (0 == --suite->m_refs)
+        destroy(suite);
+    };
+    shm().atomic_func(decrement);
+  }
+
+  void test_suite::destroy(test_suite* suite)
+  {
+    // Processes that still have file mapped keep their mapping
+    string file = suite->m_file.c_str();
+    shm().destroy_ptr(suite);
+    if (!file.empty())
+    {
+      boost::system::error_code code;
+      boost::filesystem::remove(file, code);
+    }
+  }
+
+  bool test_suite::views(vector<test_view>& tests, shared_ptr<const suite_file>& file) const
+  {
+    tests.clear();
+    if (state::READY != m_state.load())
+      return false;
+    tests.reserve(m_size);
+    if (m_file.empty())
+    {
+      for (const auto& t : m_tests)
+        tests.emplace_back(t.first.view(), t.second.view());
+      return true;
+    }
+
+    file = suite_file::open(m_file.c_str());
+    if (!file || file->size() != m_size)
+      return false;
+    for (size_t i = 0; i < m_size; ++i)
+      tests.push_back(file->test(i));
+    return true;
+  }
+
+  string test_suite::suite_dir()
+  {
+    // Directory is configured once per process
+    static const string dir = []()
+    {
+      const configuration& conf = configuration::instance();
+      auto dirIt = conf.get(configuration::SUITE_DIR);
+      if (conf.invalid() == dirIt || dirIt->second.empty())
+        return string();
+
+      boost::system::error_code code;
+      boost::filesystem::create_directories(dirIt->second, code);
+      if (boost::system::errc::success != code)
+      {
+        stringstream logmsg;
+        logmsg << "Couldn't create suite directory: " << dirIt->second
+               << " Message: " << code.message() << " Tests are kept in shared memory.";
+        LOG(logmsg.str(), grader::ERROR);
+        return string();
+      }
+      return dirIt->second;
+    }();
+    return dir;
+  }
+
+  bool test_suite::store_tests(const vector<test_view>& views, const string& hash, size_t memoryBytes, size_t timeMS,
+                               const string& language, size_t parallelism, shm_test_vector& tests, string& file)
+  {
+    // Test data goes to compiled file when possible (file name is unique, so it's removed together with suite)
+    auto dir = suite_dir();
+    if (!dir.empty())
+    {
+      file = dir + "/" + hash + "-" + boost::uuids::to_string(boost::uuids::random_generator()()) + ".suite";
+      if (suite_file::write(file, views, memoryBytes, timeMS, language, parallelism))
+        return true;
+      file.clear();
+    }
+
+    // Generated tests can easily be bigger than whole segment
+    try
+    {
+      tests.reserve(views.size());
+      for (const auto& view : views)
+        tests.emplace_back(subtest(subtest::subtest_in, view.first), subtest(subtest::subtest_out, view.second));
+    }
+    catch (const exception& e)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't store tests in shared memory (configure SUITE_DIR for big tests). Error message: " << e.what();
+      LOG(logmsg.str(), grader::ERROR);
+      return false;
+    }
+    return true;
+  }
+
+  bool test_suite::register_suite(test_suite* suite)
+  {
+    // Suite is registered only once, so single unregister frees it
+    bool registered = false;
+    auto reg = [&]()
+    {
+      if (!suite->m_registered)
+      {
+        suite->m_registered = registered = true;
+        ++suite->m_refs;
+      }
+    };
+    shm().atomic_func(reg);
+    return registered;
+  }
+
+  bool test_suite::unregister_suite(const char* hash)
+  {
+    // Tasks that still use suite keep it alive, it can't be referenced by hash anymore after they finish
+    auto name = shm_name(hash);
+    bool unregistered = false;
+    auto unreg = [&]()
+    {
+      auto found = shm().find_no_lock<test_suite>(name.c_str());
+      if (0 != found.second && found.first->m_registered)
+      {
+        test_suite* suite = found.first;
+        suite->m_registered = false;
+        unregistered = true;
+        if (0 == --suite->m_refs)
+          destroy(suite);
+      }
+    };
+    shm().atomic_func(unreg);
+    return unregistered;
+  }
+
+  bool test_suite::is_valid_hash(const char* hash)
+  {
+    auto len = strlen(hash);
+    return sizeof(shm_hash) - 1 == len && all_of(hash, hash + len, [](char c) { return isxdigit(static_cast<unsigned char>(c)) && !isupper(static_cast<unsigned char>(c)); });
+  }
+}
@@ -0,0 +1,184 @@
+// Project headers
+#include "grader_daemon.hpp"
+#include "job_queue.hpp"
+#include "task_reaper.hpp"
+#include "task.hpp"
+#include "epoch_manager.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+
+// STL headers
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Linux headers
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+  volatile sig_atomic_t g_stopRequested = 0;
+}
+
+namespace grader
+{
+  constexpr unsigned grader_daemon::SUPERVISE_POLL_MS;
+
+  grader_daemon::grader_daemon(size_t workersCount)
+  : m_workersCount(max<size_t>(workersCount, 1))
+  {
+  }
+
+  size_t grader_daemon::configured_workers()
+  {
+    // Number of cores by default
+    return configuration::instance().get_number(configuration::WORKERS, max(thread::hardware_concurrency(), 1U));
+  }
+
+  int grader_daemon::run()
+  {
+    // Install handlers so that pool can be stopped gracefully
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &grader_daemon::stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+    
+    // Writing to pipe of test process that already exited (or was killed) must not kill worker
+    signal(SIGPIPE, SIG_IGN);
+
+    // Make sure queue exists before any worker starts waiting on it
+    job_queue::instance();
+
+    // Fork workers
+    for (size_t i = 0; i < m_workersCount; ++i)
+    {
+      pid_t pid = spawn_worker();
+      if (-1 == pid)
+      {
+        stop_workers();
+        return EXIT_FAILURE;
+      }
+      m_workers.push_back(pid);
+    }
+
+    stringstream logmsg;
+    logmsg << "Grading daemon started with " << m_workersCount << " workers.";
+    LOG(logmsg.str(), grader::INFO);
+
+    // Supervise workers: replace every worker that dies until stop is requested, collect tasks in between
+    task_reaper& reaper = task_reaper::instance();
+    auto nextReap = chrono::steady_clock::now();
+    while (!g_stopRequested)
+    {
+      int status;
+      pid_t deadPid = waitpid(-1, &status, WNOHANG);
+      if (0 == deadPid)
+      {
+        // Dead workers are collected first, so reaper sees that they are gone
+        if (chrono::steady_clock::now() >= nextReap)
+        {
+          reaper.reap();
+          nextReap = chrono::steady_clock::now() + chrono::milliseconds(reaper.interval_ms());
+        }
+        this_thread::sleep_for(chrono::milliseconds(SUPERVISE_POLL_MS));
+        continue;
+      }
+      if (-1 == deadPid)
+      {
+        if (EINTR == errno) continue;
+        stringstream logmsg;
+        logmsg << "Waiting for workers failed! Error msg: " << strerror(errno);
+        LOG(logmsg.str(), grader::ERROR);
+        break;
+      }
+
+      auto it = find(m_workers.begin(), m_workers.end(), deadPid);
+      if (m_workers.end() == it)
+        continue;
+
+      stringstream logmsg;
+      logmsg << "Worker with pid: " << deadPid << " died (status: " << status << "), starting new one.";
+      LOG(logmsg.str(), grader::WARNING);
+      *it = spawn_worker();
+      if (-1 == *it)
+      {
+        m_workers.erase(it);
+        if (m_workers.empty())
+          return EXIT_FAILURE;
+      }
+    }
+
+    stop_workers();
+    LOG("Grading daemon stopped.", grader::INFO);
+    return EXIT_SUCCESS;
+  }
+
+  pid_t grader_daemon::spawn_worker()
+  {
+    pid_t pid = fork();
+    if (-1 == pid)
+    {
+      stringstream logmsg;
+      logmsg << "Forking worker process failed! Error msg: " << strerror(errno);
+      LOG(logmsg.str(), grader::ERROR);
+      return -1;
+    }
+
+    // Child process
+    if (0 == pid)
+    {
+      worker_loop();
+      _exit(EXIT_SUCCESS);
+    }
+    return pid;
+  }
+
+  void grader_daemon::stop_workers()
+  {
+    for (auto pid : m_workers)
+      kill(pid, SIGTERM);
+    for (auto pid : m_workers)
+    {
+      int status;
+      while (-1 == waitpid(pid, &status, 0) && EINTR == errno);
+    }
+    m_workers.clear();
+  }
+
+  void grader_daemon::worker_loop()
+  {
+    job_queue& queue = job_queue::instance();
+    task::shm_id taskId;
+    while (!g_stopRequested)
+    {
+      if (!queue.pop(taskId, POP_TIMEOUT_MS))
+        continue;
+
+      // Task can be deleted as soon as it reaches final state, worker still uses it after that
+      task::pin foundTask(taskId);
+      if (!foundTask)
+      {
+        stringstream logmsg;
+        logmsg << "Task with id: " << taskId << " was removed before it was graded.";
+        LOG(logmsg.str(), grader::WARNING);
+        continue;
+      }
+      foundTask->run_all();
+    }
+  }
+
+  void grader_daemon::stop_handler(int)
+  {
+    g_stopRequested = 1;
+  }
+}
@@ -0,0 +1,80 @@
+// Project headers
+#include "job_queue.hpp"
+#include "configuration.hpp"
+#include "epoch_manager.hpp"
+#include "grader_log.hpp"
+
+// STL headers
+#include <cstring>
+#include <string>
+#include <sstream>
+
+// BOOST headers
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+using namespace std;
+
+namespace grader
+{
+  const char* job_queue::SHM_NAME = "grader_job_queue";
+
+  job_queue::job_queue(size_t capacity)
+  : m_jobs(shm().get_segment_manager()), m_head(0), m_size(0)
+  {
+    m_jobs.resize(capacity);
+  }
+
+  job_queue& job_queue::instance()
+  {
+    // Read capacity from configuration (used only by process that constructs queue)
+    size_t capacity = configuration::instance().get_number(configuration::QUEUE_SIZE, DEFAULT_CAPACITY);
+
+    static job_queue* queue = shm().find_or_construct<job_queue>(SHM_NAME)(capacity);
+    return *queue;
+  }
+
+  bool job_queue::try_push(const char* taskId)
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    if (m_size == m_jobs.size())
+      return false;
+
+    auto& slot = m_jobs[(m_head + m_size) % m_jobs.size()];
+    strncpy(slot.id, taskId, sizeof(slot.id) - 1);
+    slot.id[sizeof(slot.id) - 1] = '\0';
+    ++m_size;
+    m_notEmpty.notify_one();
+    return true;
+  }
+
+  bool job_queue::pop(task::shm_id& taskId, unsigned timeoutMS)
+  {
+    using namespace boost::posix_time;
+    auto deadline = microsec_clock::universal_time() + milliseconds(timeoutMS);
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    while (0 == m_size)
+    {
+      if (!m_notEmpty.timed_wait(lock, deadline) && 0 == m_size)
+        return false;
+    }
+
+    // Task is claimed before its job leaves queue, so task of worker that dies right after pop is still ended by task_reaper
+    const auto& slot = m_jobs[m_head];
+    copy(slot.id, slot.id + sizeof(slot.id), taskId);
+    {
+      epoch_manager::guard readGuard;
+      if (task* t = task::find(taskId))
+        t->claim();
+    }
+    m_head = (m_head + 1) % m_jobs.size();
+    --m_size;
+    return true;
+  }
+
+  size_t job_queue::size()
+  {
+    boost::interprocess::scoped_lock<mutex_type> lock(m_lock);
+    return m_size;
+  }
+}
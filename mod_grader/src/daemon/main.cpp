@@ -0,0 +1,10 @@
+// Project headers
+#include "grader_daemon.hpp"
+
+using namespace grader;
+
+int main()
+{
+  grader_daemon daemon(grader_daemon::configured_workers());
+  return daemon.run();
+}
@@ -0,0 +1,81 @@
+// Project headers
+#include "task_reaper.hpp"
+#include "task.hpp"
+#include "task_table.hpp"
+#include "epoch_manager.hpp"
+#include "configuration.hpp"
+#include "grader_log.hpp"
+#include "process.hpp"
+
+// STL headers
+#include <algorithm>
+#include <ctime>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+static_assert(ATOMIC_LONG_LOCK_FREE == 2, "Reaper counters must be lock free to live in shared memory");
+
+namespace grader
+{
+  const char* task_reaper::SHM_COUNTERS_NAME = "grader_task_reaper_counters";
+  constexpr size_t task_reaper::DEFAULT_TTL_S;
+  constexpr size_t task_reaper::DEFAULT_INTERVAL_MS;
+
+  task_reaper::task_reaper()
+  : m_ttlS(configuration::instance().get_number(configuration::TASK_TTL, DEFAULT_TTL_S)),
+    m_intervalMS(max<size_t>(configuration::instance().get_number(configuration::REAPER_INTERVAL_MS, DEFAULT_INTERVAL_MS), 1)),
+    m_counters(shm().find_or_construct<counters>(SHM_COUNTERS_NAME)())
+  {
+  }
+
+  task_reaper& task_reaper::instance()
+  {
+    static task_reaper reaper;
+    return reaper;
+  }
+
+  void task_reaper::reap()
+  {
+    size_t expired = 0, orphaned = 0;
+    {
+      // Destroyed tasks are freed only after this guard is left, so table can be walked while destroying
+      epoch_manager::guard readGuard;
+      auto now = time(nullptr);
+      task_table::instance().for_each([&](const char* id, task* t)
+      {
+        auto s = t->get_state();
+        if (task::is_terminal(s))
+        {
+          if (0 != m_ttlS && t->finished_at() + static_cast<int64_t>(m_ttlS) <= now && !t->has_waiters())
+          {
+            task::destroy(t);
+            ++expired;
+          }
+        }
+        else if (is_dead(t->owner()))
+        {
+          stringstream logmsg;
+          logmsg << "Worker with pid: " << t->owner() << " died while grading task with id: " << id
+                 << " Task is ended as invalid.";
+          LOG(logmsg.str(), grader::WARNING);
+          t->reject();
+          ++orphaned;
+        }
+      });
+    }
+    epoch_manager::instance().reclaim();
+
+    m_counters->passes.fetch_add(1, memory_order_relaxed);
+    m_counters->expired.fetch_add(expired, memory_order_relaxed);
+    m_counters->orphaned.fetch_add(orphaned, memory_order_relaxed);
+    if (0 != expired)
+    {
+      stringstream logmsg;
+      logmsg << "Removed " << expired << " expired tasks. Tasks left: " << task_table::instance().size()
+             << " Free shared memory: " << shm().get_free_memory() << " bytes.";
+      LOG(logmsg.str(), grader::INFO);
+    }
+  }
+}
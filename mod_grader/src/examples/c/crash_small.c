@@ -0,0 +1,12 @@
+#include <stdlib.h>
+#include <unistd.h>
+/*
+ * This example aborts while using little memory, so its test simply fails (crash far below memory limit isn't MLE).
+ * */
+
+int main()
+{
+  usleep(100000);
+  abort();
+  return 0;
+}
@@ -0,0 +1,14 @@
+#include <stdio.h>
+#include <unistd.h>
+/*
+ * This example writes wrong answer at once and then sleeps, grader kills it at first wrong byte of output
+ * instead of waiting for time limit.
+ * */
+
+int main()
+{
+  printf("1\n");
+  fflush(stdout);
+  sleep(60);
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/*
+ * This example allocates and touches memory until it's refused, so it breaks memory limit of its test (MLE).
+ * Grader with cgroup kills it, without cgroup allocation fails near address space limit and example
+ * aborts (it waits a moment before that, as program busy with its data would).
+ * */
+
+int main()
+{
+  const size_t chunkSize = 1 << 20;
+  for (;;)
+  {
+    char* chunk = malloc(chunkSize);
+    if (!chunk)
+    {
+      usleep(100000);
+      abort();
+    }
+    memset(chunk, 1, chunkSize);
+  }
+  return 0;
+}
@@ -0,0 +1,11 @@
+/*
+ * This example never ends and keeps processor busy, so it breaks time limit of its test (TLE).
+ * */
+
+int main()
+{
+  volatile unsigned long counter = 0;
+  for (;;)
+    ++counter;
+  return 0;
+}
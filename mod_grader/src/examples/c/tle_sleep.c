@@ -0,0 +1,10 @@
+#include <unistd.h>
+/*
+ * This example sleeps without using processor, so only wall time limit of its test stops it (TLE).
+ * */
+
+int main()
+{
+  sleep(60);
+  return 0;
+}
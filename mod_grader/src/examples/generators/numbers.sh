@@ -0,0 +1,7 @@
+#!/bin/sh
+# Test generator: prints count of numbers and then that many consecutive numbers starting from seed.
+# Usage: numbers.sh <seed> <count>
+seed=$1
+count=$2
+echo "$count"
+seq "$seed" $((seed + count - 1))
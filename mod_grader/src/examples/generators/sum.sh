@@ -0,0 +1,3 @@
+#!/bin/sh
+# Reference solution: reads count of numbers and numbers from standard input and prints their sum.
+awk 'NR == 1 { next } { sum += $1 } END { print sum + 0 }'
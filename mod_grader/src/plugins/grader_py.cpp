@@ -57,8 +57,9 @@ bool grader_py::is_interpreted() const
   return true;
 }
 
-Poco::ProcessHandle grader_py::start_executable_process(const string& executable, const vector< string >& args, 
-                                                        const string& workingDir, Poco::Pipe* toBinaries, Poco::Pipe* fromBinaries) const
+grader::process_handle grader_py::start_executable_process(const string& executable, const vector< string >& args, 
+                                                           const string& workingDir, Poco::Pipe* toBinaries, Poco::Pipe* fromBinaries,
+                                                           const grader::process_limits& limits) const
 {
   auto source = executable + ".py";
   try
@@ -70,6 +71,6 @@ Poco::ProcessHandle grader_py::start_executable_process(const string& executable
   } catch (const std::exception& e)
   {
   }
-  return grader::grader_base::start_executable_process(source, args, workingDir, toBinaries, fromBinaries);
+  return grader::grader_base::start_executable_process(source, args, workingDir, toBinaries, fromBinaries, limits);
 }
 
@@ -0,0 +1,37 @@
+// Project headers
+#include "hash.hpp"
+
+// STL headers
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace grader
+{
+  sha1_hasher& sha1_hasher::update(const void* data, size_t len)
+  {
+    m_sha1.process_bytes(data, len);
+    return *this;
+  }
+
+  sha1_hasher& sha1_hasher::update(const string& str)
+  {
+    // Length goes first so that consecutive strings can't be shifted into each other
+    size_t len = str.size();
+    update(&len, sizeof(len));
+    return update(str.data(), len);
+  }
+
+  string sha1_hasher::hex_digest()
+  {
+    // Digest element type differs between boost versions, so width is derived from it
+    boost::uuids::detail::sha1::digest_type digest;
+    m_sha1.get_digest(digest);
+    stringstream hex;
+    hex << std::hex << setfill('0');
+    for (auto part : digest)
+      hex << setw(sizeof(part) * 2) << static_cast<unsigned long>(part);
+    return hex.str();
+  }
+}
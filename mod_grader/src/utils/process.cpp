@@ -0,0 +1,555 @@
+// Project headers
+#include "process.hpp"
+#include "grader_log.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+// Poco headers
+#include <Poco/Pipe.h>
+
+// Linux headers
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+namespace
+{
+  // Exit code of child when something between spawn and exec fails
+  constexpr int CHILD_SETUP_FAILED = 127;
+  constexpr size_t CHILD_STACK_SIZE = 1U << 18; // 256KB, execvp searches PATH on stack
+
+  bool write_file(const string& path, const string& content)
+  {
+    ofstream f(path);
+    f << content;
+    f.close();
+    return !f.fail();
+  }
+
+  // Creates cgroup for process and returns opened cgroup.procs (or -1 when cgroup can't be used)
+  int prepare_cgroup(const grader::process_limits& limits)
+  {
+    if (-1 == mkdir(limits.cgroupDir.c_str(), 0755) && EEXIST != errno)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't create cgroup: " << limits.cgroupDir
+             << " Error msg: " << strerror(errno) << " Falling back to rlimits.";
+      LOG(logmsg.str(), grader::WARNING);
+      return -1;
+    }
+
+    if (0 != limits.memoryBytes && !write_file(limits.cgroupDir + "/memory.max", to_string(limits.memoryBytes)))
+    {
+      LOG("Couldn't set memory.max for cgroup: " + limits.cgroupDir + " Falling back to rlimits.", grader::WARNING);
+      rmdir(limits.cgroupDir.c_str());
+      return -1;
+    }
+    write_file(limits.cgroupDir + "/memory.swap.max", "0"); // Swap controller may be disabled, that's fine
+
+    int procsFd = open((limits.cgroupDir + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    if (-1 == procsFd)
+    {
+      LOG("Couldn't open cgroup.procs for cgroup: " + limits.cgroupDir + " Falling back to rlimits.", grader::WARNING);
+      rmdir(limits.cgroupDir.c_str());
+    }
+    return procsFd;
+  }
+
+  // Serializes reset and sampling of our peak RSS around spawn of child
+  mutex g_peakRssLock;
+
+  // Peak resident set size of this process, child created with CLONE_VM inherits it at exec
+  size_t own_peak_rss_kb()
+  {
+    ifstream procStatus("/proc/self/status");
+    string key;
+    while (procStatus >> key)
+    {
+      size_t kb;
+      if ("VmHWM:" == key && procStatus >> kb)
+        return kb;
+      procStatus.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+    return 0;
+  }
+
+  void close_fds_from(int firstFd, long maxFd)
+  {
+#ifdef SYS_close_range
+    if (0 == syscall(SYS_close_range, firstFd, ~0U, 0))
+      return;
+#endif
+    for (long fd = firstFd; fd < maxFd; ++fd)
+      close(static_cast<int>(fd));
+  }
+
+  // Everything child needs is computed by parent, child writes only error
+  struct child_context
+  {
+    char** argv;
+    const char* workingDir;
+    int inFd, outFd, errFd;
+    int cgroupProcsFd;
+    bool hasCPULimit, hasMemoryLimit;
+    rlimit cpuLimit, memoryLimit, coreLimit;
+    long maxFd;
+    sigset_t oldMask; /**< Signal mask of parent thread before spawning. */
+    int error; /**< Errno of step that failed in child (zero if exec succeeded). */
+  };
+
+  // Runs in child that shares memory with parent (until exec), only async-signal-safe functions may be used
+  int child_main(void* arg)
+  {
+    auto ctx = static_cast<child_context*>(arg);
+
+    // Handlers (and ignored signals like SIGPIPE) of grader aren't meant for tested program
+    struct sigaction defaultAction;
+    memset(&defaultAction, 0, sizeof(defaultAction));
+    defaultAction.sa_handler = SIG_DFL;
+    for (int sig = 1; sig < NSIG; ++sig)
+      sigaction(sig, &defaultAction, nullptr);
+    sigprocmask(SIG_SETMASK, &ctx->oldMask, nullptr);
+
+    if ((-1 != ctx->cgroupProcsFd && write(ctx->cgroupProcsFd, "0", 1) < 0) ||
+        -1 == dup2(ctx->inFd, STDIN_FILENO) || -1 == dup2(ctx->outFd, STDOUT_FILENO) || -1 == dup2(ctx->errFd, STDERR_FILENO) ||
+        (ctx->workingDir && 0 != chdir(ctx->workingDir)) ||
+        (ctx->hasCPULimit && 0 != setrlimit(RLIMIT_CPU, &ctx->cpuLimit)) ||
+        (ctx->hasMemoryLimit && 0 != setrlimit(RLIMIT_AS, &ctx->memoryLimit)) ||
+        0 != setrlimit(RLIMIT_CORE, &ctx->coreLimit))
+    {
+      ctx->error = errno;
+      _exit(CHILD_SETUP_FAILED);
+    }
+    close_fds_from(STDERR_FILENO + 1, ctx->maxFd);
+    execvp(ctx->argv[0], ctx->argv);
+    ctx->error = errno;
+    _exit(CHILD_SETUP_FAILED);
+  }
+}
+
+namespace grader
+{
+  constexpr size_t process_handle::IO_CHUNK_SIZE;
+  constexpr unsigned process_handle::SAMPLE_INTERVAL_MS;
+  constexpr size_t process_handle::MLE_NEAR_LIMIT_PERCENT;
+
+  process_handle::process_handle(pid_t pid, const process_limits& limits, size_t inheritedRssKB)
+  : m_pid(pid), m_limits(limits), m_started(clock_type::now()), m_reaped(false), m_killed(false),
+    m_nextSample(m_started), m_peakVirtualKB(0), m_peakRssKB(0), m_inheritedRssKB(inheritedRssKB)
+  {
+    sample_memory();
+  }
+
+  process_handle::~process_handle()
+  {
+    // Never leave running process or zombie behind
+    if (!m_reaped)
+    {
+      kill();
+      reap();
+    }
+  }
+
+  process_handle::process_handle(process_handle&& oth)
+  : m_pid(oth.m_pid), m_limits(move(oth.m_limits)), m_started(oth.m_started), m_reaped(oth.m_reaped), m_killed(oth.m_killed),
+    m_nextSample(oth.m_nextSample), m_peakVirtualKB(oth.m_peakVirtualKB), m_peakRssKB(oth.m_peakRssKB),
+    m_inheritedRssKB(oth.m_inheritedRssKB), m_status(oth.m_status)
+  {
+    oth.m_pid = -1;
+    oth.m_reaped = true;
+  }
+
+  process_handle& process_handle::operator=(process_handle&& oth)
+  {
+    if (&oth != this)
+    {
+      if (!m_reaped)
+      {
+        kill();
+        reap();
+      }
+      m_pid = oth.m_pid;
+      m_limits = move(oth.m_limits);
+      m_started = oth.m_started;
+      m_reaped = oth.m_reaped;
+      m_killed = oth.m_killed;
+      m_nextSample = oth.m_nextSample;
+      m_peakVirtualKB = oth.m_peakVirtualKB;
+      m_peakRssKB = oth.m_peakRssKB;
+      m_inheritedRssKB = oth.m_inheritedRssKB;
+      m_status = oth.m_status;
+      oth.m_pid = -1;
+      oth.m_reaped = true;
+    }
+    return *this;
+  }
+
+  long process_handle::remaining_ms() const
+  {
+    if (0 == m_limits.wallTimeMS)
+      return -1;
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(clock_type::now() - m_started).count();
+    return max(static_cast<long>(m_limits.wallTimeMS) - static_cast<long>(elapsed), 0L);
+  }
+
+  const process_status& process_handle::wait()
+  {
+    if (m_reaped)
+      return m_status;
+
+    if (!wait_for_exit())
+    {
+      kill();
+      m_status.wallTimeExceeded = true;
+    }
+    reap();
+    return m_status;
+  }
+
+  void process_handle::kill()
+  {
+    if (!m_reaped)
+    {
+      m_killed = true;
+      ::kill(m_pid, SIGKILL);
+    }
+  }
+
+  /**
+   * Writes input to process and reads its output at the same time, so neither side can block
+   * on full pipe. Returns when input is written and output is closed, when wall time limit is
+   * reached or when output handler returns false or polling fails (process is killed in that case and
+   * false is returned).
+   * Either pipe may be nullptr.
+   */
+  bool process_handle::communicate(Poco::Pipe* inPipe, const char* input, size_t inputLen,
+                                   Poco::Pipe* outPipe, const output_handler& onOutput)
+  {
+    bool inputDone = nullptr == inPipe;
+    bool outputDone = nullptr == outPipe;
+    if (!inputDone)
+    {
+      int inFd = inPipe->writeHandle();
+      fcntl(inFd, F_SETFL, fcntl(inFd, F_GETFL) | O_NONBLOCK);
+      if (0 == inputLen)
+      {
+        inPipe->close(Poco::Pipe::CLOSE_WRITE);
+        inputDone = true;
+      }
+    }
+
+    char buffer[IO_CHUNK_SIZE];
+    size_t written = 0;
+    bool aborted = false;
+    while (!aborted && (!inputDone || !outputDone))
+    {
+      pollfd fds[2];
+      nfds_t count = 0;
+      pollfd* inPoll = nullptr;
+      pollfd* outPoll = nullptr;
+      if (!inputDone)
+      {
+        inPoll = &fds[count++];
+        *inPoll = pollfd{inPipe->writeHandle(), POLLOUT, 0};
+      }
+      if (!outputDone)
+      {
+        outPoll = &fds[count++];
+        *outPoll = pollfd{outPipe->readHandle(), POLLIN, 0};
+      }
+
+      // Nothing happened until wall time limit, wait() will kill process
+      int ready = poll(fds, count, poll_timeout());
+      if (-1 == ready && EINTR == errno) continue;
+      if (-1 == ready)
+      {
+        stringstream logmsg;
+        logmsg << "Polling pipes of process with pid: " << m_pid << " failed! Error msg: " << strerror(errno);
+        LOG(logmsg.str(), grader::WARNING);
+        aborted = true;
+        break;
+      }
+      sample_memory();
+      if (0 == ready)
+      {
+        if (0 == remaining_ms()) break;
+        continue;
+      }
+
+      // Feed input as much as pipe can take, process that closed stdin just doesn't get rest of input
+      if (inPoll && 0 != inPoll->revents)
+      {
+        ssize_t bytesWritten = write(inPoll->fd, input + written, min(inputLen - written, IO_CHUNK_SIZE));
+        if (bytesWritten > 0)
+          written += static_cast<size_t>(bytesWritten);
+        if (written == inputLen || (-1 == bytesWritten && EAGAIN != errno && EINTR != errno))
+        {
+          inPipe->close(Poco::Pipe::CLOSE_WRITE);
+          inputDone = true;
+        }
+      }
+
+      // Drain output and pass it to handler
+      if (outPoll && 0 != outPoll->revents)
+      {
+        ssize_t bytesRead = read(outPoll->fd, buffer, sizeof(buffer));
+        if (0 == bytesRead || (-1 == bytesRead && EINTR != errno))
+          outputDone = true;
+        else if (bytesRead > 0 && !onOutput(buffer, static_cast<size_t>(bytesRead)))
+          aborted = true;
+      }
+    }
+
+    if (!inputDone)
+      inPipe->close(Poco::Pipe::CLOSE_WRITE);
+    if (aborted)
+      kill();
+    return !aborted;
+  }
+
+  // Returns false when wall time limit was reached before process exited
+  bool process_handle::wait_for_exit()
+  {
+    // Preferred way is to poll process file descriptor, so we are woken up exactly when child exits
+#ifdef SYS_pidfd_open
+    int pidFd = static_cast<int>(syscall(SYS_pidfd_open, m_pid, 0));
+    if (-1 != pidFd)
+    {
+      pollfd pfd{pidFd, POLLIN, 0};
+      int ready;
+      while (true)
+      {
+        ready = poll(&pfd, 1, poll_timeout());
+        if (-1 == ready && EINTR == errno) continue;
+        if (0 != ready || 0 == remaining_ms()) break;
+        sample_memory();
+      }
+      close(pidFd);
+      return 1 == ready;
+    }
+#endif
+
+    // Older kernels: check if child exited (without reaping it) every few milliseconds
+    while (true)
+    {
+      siginfo_t info;
+      info.si_pid = 0;
+      if (0 == waitid(P_PID, m_pid, &info, WEXITED | WNOHANG | WNOWAIT) && 0 != info.si_pid)
+        return true;
+      if (0 == remaining_ms())
+        return false;
+      sample_memory();
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+  }
+
+  int process_handle::poll_timeout() const
+  {
+    // Without cgroup memory is sampled, so waiting wakes up every SAMPLE_INTERVAL_MS
+    long remaining = remaining_ms();
+    if (!m_limits.cgroupDir.empty())
+      return static_cast<int>(remaining);
+    return static_cast<int>(-1 == remaining ? SAMPLE_INTERVAL_MS : min<long>(remaining, SAMPLE_INTERVAL_MS));
+  }
+
+  void process_handle::sample_memory()
+  {
+    // Address space of process that exited is gone (zombie has no Vm* fields), last sample stays.
+    // With cgroup waiting doesn't wake up for samples, so only few are taken (cgroup measures memory itself)
+    if (m_reaped || clock_type::now() < m_nextSample)
+      return;
+    m_nextSample = clock_type::now() + chrono::milliseconds(SAMPLE_INTERVAL_MS);
+    ifstream procStatus("/proc/" + to_string(m_pid) + "/status");
+    string key;
+    while (procStatus >> key)
+    {
+      size_t kb;
+      if ("VmPeak:" == key && procStatus >> kb)
+        m_peakVirtualKB = max(m_peakVirtualKB, kb);
+      else if ("VmHWM:" == key && procStatus >> kb)
+        m_peakRssKB = max(m_peakRssKB, kb);
+      procStatus.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+  }
+
+  void process_handle::reap()
+  {
+    int status = 0;
+    pid_t ret;
+    do
+    {
+      ret = wait4(m_pid, &status, 0, &m_status.usage);
+    } while (-1 == ret && EINTR == errno);
+    m_reaped = true;
+    m_status.wallTimeMS = chrono::duration_cast<chrono::milliseconds>(clock_type::now() - m_started).count();
+    if (-1 == ret)
+    {
+      stringstream logmsg;
+      logmsg << "Waiting for process with pid: " << m_pid << " failed! Error msg: " << strerror(errno);
+      LOG(logmsg.str(), grader::ERROR);
+      return;
+    }
+
+    if (WIFEXITED(status))
+    {
+      m_status.exitCode = WEXITSTATUS(status);
+    }
+    else if (WIFSIGNALED(status))
+    {
+      m_status.signal = WTERMSIG(status);
+    }
+
+    // Soft CPU limit delivers SIGXCPU, hard one SIGKILL, and limit itself has only seconds granularity
+    m_status.cpuTimeMS = (m_status.usage.ru_utime.tv_sec + m_status.usage.ru_stime.tv_sec) * 1000L +
+                         (m_status.usage.ru_utime.tv_usec + m_status.usage.ru_stime.tv_usec) / 1000L;
+    if (0 != m_limits.cpuTimeMS)
+    {
+      m_status.cpuTimeExceeded = SIGXCPU == m_status.signal || m_status.cpuTimeMS > m_limits.cpuTimeMS;
+    }
+
+    // Child shared our memory until exec, so ru_maxrss is at least our peak then and tells about program
+    // only above it, below it sampled peak is used (cgroup reports exact peak, see read_cgroup_events)
+    auto maxRssKB = static_cast<size_t>(m_status.usage.ru_maxrss);
+    m_status.peakMemoryKB = maxRssKB > m_inheritedRssKB ? maxRssKB : m_peakRssKB;
+
+    if (!m_limits.cgroupDir.empty())
+    {
+      read_cgroup_events();
+      rmdir(m_limits.cgroupDir.c_str());
+    }
+    else
+      classify_crash();
+  }
+
+  void process_handle::read_cgroup_events()
+  {
+    ifstream events(m_limits.cgroupDir + "/memory.events");
+    string key;
+    size_t count;
+    while (events >> key >> count)
+    {
+      if ("oom_kill" == key && 0 != count)
+        m_status.memoryExceeded = true;
+    }
+
+    // Cgroup was created for this process alone, so its peak is peak of process (kernels before 5.19 don't have it)
+    ifstream peak(m_limits.cgroupDir + "/memory.peak");
+    size_t peakBytes;
+    if (peak >> peakBytes)
+      m_status.peakMemoryKB = peakBytes / 1024;
+  }
+
+  void process_handle::classify_crash()
+  {
+    // Allocation beyond address space limit fails, program then crashes (or exits with error) instead of being killed
+    if (0 == m_limits.memoryBytes || m_killed || m_status.cpuTimeExceeded)
+      return;
+    bool crashed = SIGSEGV == m_status.signal || SIGBUS == m_status.signal || SIGABRT == m_status.signal ||
+                   SIGKILL == m_status.signal || m_status.exitCode > 0;
+    m_status.memoryExceeded = crashed && m_peakVirtualKB * 1024 * 100 >= m_limits.memoryBytes * MLE_NEAR_LIMIT_PERCENT;
+  }
+
+  process_handle launch_process(const string& executable, const vector<string>& args, const string& workingDir,
+                                Poco::Pipe* inPipe, Poco::Pipe* outPipe, Poco::Pipe* errPipe, const process_limits& limits)
+  {
+    // Prepare everything before spawning, child shares our memory and may only use async-signal-safe functions
+    vector<char*> argv;
+    argv.reserve(args.size() + 2);
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (const auto& arg : args)
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    process_limits appliedLimits = limits;
+    child_context ctx;
+    ctx.argv = argv.data();
+    ctx.workingDir = workingDir.empty() ? nullptr : workingDir.c_str();
+    ctx.cgroupProcsFd = -1;
+    if (!appliedLimits.cgroupDir.empty())
+    {
+      ctx.cgroupProcsFd = prepare_cgroup(appliedLimits);
+      if (-1 == ctx.cgroupProcsFd)
+        appliedLimits.cgroupDir.clear();
+    }
+
+    ctx.hasCPULimit = 0 != appliedLimits.cpuTimeMS;
+    ctx.hasMemoryLimit = 0 != appliedLimits.memoryBytes && appliedLimits.cgroupDir.empty();
+    ctx.cpuLimit.rlim_cur = (appliedLimits.cpuTimeMS + 999) / 1000;
+    ctx.cpuLimit.rlim_max = ctx.cpuLimit.rlim_cur + 1;
+    ctx.memoryLimit.rlim_cur = ctx.memoryLimit.rlim_max = appliedLimits.memoryBytes;
+    ctx.coreLimit.rlim_cur = ctx.coreLimit.rlim_max = 0;
+
+    int devNull = open("/dev/null", O_RDWR | O_CLOEXEC);
+    ctx.inFd = inPipe ? inPipe->readHandle() : devNull;
+    ctx.outFd = outPipe ? outPipe->writeHandle() : devNull;
+    ctx.errFd = errPipe ? errPipe->writeHandle() : devNull;
+    ctx.maxFd = sysconf(_SC_OPEN_MAX);
+    ctx.error = 0;
+
+    // Child gets its own stack, but no copy of page tables: we are suspended until it execs (or exits).
+    // Signals are blocked meanwhile so none of our handlers can run on child's side of shared memory.
+    // Our peak RSS is reset to current RSS first, child inherits it at exec (see process_handle::reap).
+    // Peak RSS is per process, so launches from other test threads wait until it's sampled.
+    unique_ptr<char[]> childStack(new char[CHILD_STACK_SIZE]);
+    pid_t pid;
+    int cloneErr;
+    size_t inheritedRssKB;
+    {
+      lock_guard<mutex> lock(g_peakRssLock);
+      write_file("/proc/self/clear_refs", "5");
+      sigset_t allSignals;
+      sigfillset(&allSignals);
+      pthread_sigmask(SIG_BLOCK, &allSignals, &ctx.oldMask);
+      pid = clone(&child_main, childStack.get() + CHILD_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, &ctx);
+      cloneErr = errno;
+      pthread_sigmask(SIG_SETMASK, &ctx.oldMask, nullptr);
+      inheritedRssKB = own_peak_rss_kb();
+    }
+
+    close(devNull);
+    if (-1 != ctx.cgroupProcsFd) close(ctx.cgroupProcsFd);
+    if (-1 == pid)
+    {
+      if (!appliedLimits.cgroupDir.empty())
+        rmdir(appliedLimits.cgroupDir.c_str());
+      throw system_error(cloneErr, system_category(), "Couldn't spawn process for: " + executable);
+    }
+
+    // Child couldn't exec, it already exited with CHILD_SETUP_FAILED and is reaped as usual
+    if (0 != ctx.error)
+    {
+      stringstream logmsg;
+      logmsg << "Couldn't start: " << executable << " Error msg: " << strerror(ctx.error);
+      LOG(logmsg.str(), grader::WARNING);
+    }
+
+    // Close ends of pipes that belong to child
+    if (inPipe) inPipe->close(Poco::Pipe::CLOSE_READ);
+    if (outPipe) outPipe->close(Poco::Pipe::CLOSE_WRITE);
+    if (errPipe) errPipe->close(Poco::Pipe::CLOSE_WRITE);
+    return process_handle(pid, appliedLimits, inheritedRssKB);
+  }
+
+  bool is_dead(pid_t pid)
+  {
+    return 0 != pid && -1 == ::kill(pid, 0) && ESRCH == errno;
+  }
+}
@@ -1,7 +1,15 @@
 // Project headers
 #include "mod_grader.hpp"
 #include "request_parser.hpp"
+#include "multipart_parser.hpp"
 #include "task.hpp"
+#include "test_suite.hpp"
+#include "job_queue.hpp"
+#include "task_reaper.hpp"
+#include "compile_cache.hpp"
+#include "result_cache.hpp"
+#include "inflight_runs.hpp"
+#include "epoch_manager.hpp"
 #include "configuration.hpp"
 #include "grader_log.hpp"
 
@@ -10,8 +18,10 @@
 #include <cctype>
 #include <iostream>
 #include <fstream>
-#include <cerrno>
 #include <string>
+#include <sstream>
+#include <algorithm>
+#include <vector>
 
 // BOOST headers
 #include <boost/algorithm/string.hpp>
@@ -21,14 +31,371 @@
 // Apache headers
 #include <apr_tables.h>
 
-// Linux headers
-#include <csignal>
-#include <sys/wait.h>
-#include <unistd.h>
-
 using namespace std;
 using namespace grader;
 
+namespace
+{
+  // Value of parameter from query string (empty if it's not present), values used by grader need no decoding
+  string query_param(request_rec* r, const string& name)
+  {
+    if (!r->args)
+      return "";
+    stringstream args(r->args);
+    string param;
+    while (getline(args, param, '&'))
+    {
+      if (0 == param.compare(0, name.size(), name) && param.size() > name.size() && '=' == param[name.size()])
+        return param.substr(name.size() + 1);
+    }
+    return "";
+  }
+  
+  // How long GET may block waiting for task state change (zero means answer immediately)
+  unsigned long long_poll_ms(request_rec* r)
+  {
+    string waitStr = query_param(r, "wait");
+    if (waitStr.empty())
+      return 0;
+    
+    unsigned long maxWaitMS = configuration::instance().get_number(configuration::LONG_POLL_MAX_MS, DEFAULT_LONG_POLL_MAX_MS);
+    try 
+    {
+      return min(stoul(waitStr), maxWaitMS);
+    } 
+    catch (const exception& e) 
+    {
+      stringstream logmsg;
+      logmsg << "Invalid wait parameter: " << waitStr << ", not waiting. "
+             << "Error message: " << e.what();
+      LOG(logmsg.str(), grader::WARNING);
+    }
+    return 0;
+  }
+  
+  // Server-Sent Events: every event from task's log is pushed to client as soon as it's published
+  void stream_events(request_rec* r, const task* t)
+  {
+    ap_set_content_type(r, "text/event-stream");
+    apr_table_setn(r->headers_out, "Cache-Control", "no-cache");
+    
+    size_t offset = 0;
+    string events;
+    bool more = true;
+    while (more && !r->connection->aborted)
+    {
+      events.clear();
+      more = t->read_events(offset, events, SSE_KEEPALIVE_MS);
+      
+      // Comment line keeps idle connection open (and lets us notice client that went away)
+      if (events.empty())
+        ap_rputs(": keepalive\n\n", r);
+      
+      // Every event is sent as one message, each line of JSON gets its own data field
+      stringstream eventsStream(events);
+      string event;
+      while (getline(eventsStream, event, task::EVENT_SEPARATOR))
+      {
+        stringstream eventStream(event);
+        string line;
+        while (getline(eventStream, line))
+          ap_rprintf(r, "data: %s\n", line.c_str());
+        ap_rputs("\n", r);
+      }
+      ap_rflush(r);
+    }
+  }
+  
+  // Statuses of many tasks in one JSON object keyed by task id (ids come in body separated by whitespace or commas)
+  int batch_status(request_rec* r)
+  {
+    request_parser parser(r);
+    char* body;
+    size_t bodyLen;
+    int httpCode = parser.read_body(body, bodyLen);
+    if (OK != httpCode)
+      return httpCode;
+    
+    // JSON array of ids is accepted as well, quotes and brackets are just more separators
+    vector<string> ids;
+    auto isSeparator = [](char c) { return isspace(static_cast<unsigned char>(c)) || ',' == c || '"' == c || '[' == c || ']' == c; };
+    const char* bodyBegin = body;
+    const char* bodyEnd = body + bodyLen;
+    for (const char* it = find_if_not(bodyBegin, bodyEnd, isSeparator); it != bodyEnd; it = find_if_not(it, bodyEnd, isSeparator))
+    {
+      const char* idEnd = find_if(it, bodyEnd, isSeparator);
+      ids.emplace_back(it, idEnd);
+      it = idEnd;
+    }
+    
+    // Lookups go straight to task table slots, no lock is taken (found tasks aren't freed until guard is gone),
+    // statuses are copied so guard isn't held while response is written to client
+    vector<bool> validNames(ids.size(), false);
+    vector<bool> found(ids.size(), false);
+    vector<string> statuses(ids.size());
+    {
+      epoch_manager::guard readGuard;
+      for (size_t i = 0; i < ids.size(); ++i)
+      {
+        validNames[i] = task::is_valid_task_name(ids[i].c_str());
+        auto foundTask = validNames[i] ? task::find(ids[i].c_str()) : nullptr;
+        if (foundTask)
+        {
+          found[i] = true;
+          statuses[i] = foundTask->status();
+        }
+      }
+    }
+    
+    ap_rputs("{\n", r);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+      const char* status;
+      if (found[i])
+        status = statuses[i].c_str();
+      else if (validNames[i])
+        status = "{ \"STATE\" : \"NOT_FOUND\" }";
+      else
+      {
+        // Invalid name is echoed back, so it must not break JSON
+        status = "{ \"STATE\" : \"INVALID_TASK_NAME\" }";
+        replace_if(ids[i].begin(), ids[i].end(), [](char c) { return '\\' == c || iscntrl(static_cast<unsigned char>(c)); }, '?');
+      }
+      ap_rprintf(r, "\"%s\" : %s%s\n", ids[i].c_str(), status, i + 1 < ids.size() ? "," : "");
+    }
+    ap_rputs("}", r);
+    return OK;
+  }
+  
+  // Occupancy of shared memory and counters summed over all processes as one JSON object
+  int stats(request_rec* r)
+  {
+    auto& table = task_table::instance();
+    auto& queue = job_queue::instance();
+    auto& runs = inflight_runs::instance();
+    const auto& compileStats = compile_cache::instance().stats();
+    const auto& resultStats = result_cache::instance().stats();
+    const auto& reaperStats = task_reaper::instance().stats();
+    ap_rprintf(r, "{ \"SEGMENT_SIZE\" : %zu, \"SEGMENT_FREE\" : %zu,\n", 
+               shm().get_size(), shm().get_free_memory());
+    ap_rprintf(r, "  \"TASKS\" : %zu, \"MAX_TASKS\" : %zu, \"RETIRED_TASKS\" : %zu,\n", 
+               table.size(), table.capacity(), epoch_manager::instance().retired());
+    ap_rprintf(r, "  \"QUEUED\" : %zu, \"QUEUE_SIZE\" : %zu,\n", queue.size(), queue.capacity());
+    ap_rprintf(r, "  \"INFLIGHT\" : { \"RUNS\" : %zu, \"FOLLOWERS\" : %lu },\n", runs.size(), runs.followers());
+    ap_rprintf(r, "  \"REAPER\" : { \"PASSES\" : %lu, \"EXPIRED\" : %lu, \"ORPHANED\" : %lu },\n", 
+               reaperStats.passes.load(), reaperStats.expired.load(), reaperStats.orphaned.load());
+    ap_rprintf(r, "  \"COMPILE_CACHE\" : { \"HITS\" : %lu, \"MISSES\" : %lu, \"EVICTIONS\" : %lu, \"BYTES\" : %lu },\n", 
+               compileStats.hits.load(), compileStats.misses.load(), compileStats.evictions.load(),
+               compileStats.bytes.load());
+    ap_rprintf(r, "  \"RESULT_CACHE\" : { \"HITS\" : %lu, \"MISSES\" : %lu, \"EVICTIONS\" : %lu, \"BYTES\" : %lu } }", 
+               resultStats.hits.load(), resultStats.misses.load(), resultStats.evictions.load(),
+               resultStats.bytes.load());
+    return OK;
+  }
+  
+  // Tests document in body is parsed and kept in shared memory until it's unregistered
+  int register_suite(request_rec* r)
+  {
+    request_parser parser(r);
+    char* body;
+    size_t bodyLen;
+    int httpCode = parser.read_body(body, bodyLen);
+    if (OK != httpCode)
+      return httpCode;
+    
+    test_suite* suite = test_suite::create(body, bodyLen);
+    if (!suite)
+      return HTTP_BAD_REQUEST;
+    test_suite::register_suite(suite);
+    
+    // Generated tests are produced by worker that grades first task of suite, suite is pending until then
+    auto state = suite->get_state();
+    const char* stateName = test_suite::state::READY == state ? "READY" : test_suite::state::PENDING == state ? "PENDING" : "INVALID";
+    ap_rprintf(r, "{ \"SUITE\" : \"%s\", \"STATE\" : \"%s\" }", suite->hash(), stateName);
+    test_suite::release(suite);
+    return OK;
+  }
+  
+  // Registry drops its reference, tasks that still use suite keep it alive until they are destroyed
+  int unregister_suite(request_rec* r)
+  {
+    string suiteHash = query_param(r, SUITE_NAME);
+    if (!test_suite::is_valid_hash(suiteHash.c_str()))
+      ap_rprintf(r, "{ \"STATE\" : \"INVALID_SUITE_NAME\" }");
+    else if (test_suite::unregister_suite(suiteHash.c_str()))
+      ap_rprintf(r, "{ \"STATE\" : \"DESTROYED\" }");
+    else
+      ap_rprintf(r, "{ \"STATE\" : \"NOT_FOUND\" }");
+    return OK;
+  }
+  
+  // Receives submission while body is parsed, sources go straight to shared memory strings that tasks take over
+  class submission_collector : public multipart_parser::handler
+  {
+  public:
+    struct source
+    {
+      string fileName;
+      task::shm_string content;
+    };
+  private:
+    vector<source> m_sources;
+    string m_tests;
+    bool m_hasTests;
+    enum class target : unsigned char { NONE, SOURCE, TESTS } m_target;
+  public:
+    submission_collector() : m_hasTests(false), m_target(target::NONE) {}
+    
+    bool begin_part(const string& name, const string& fileName) override
+    {
+      if (TESTS_FIELD_NAME == name)
+      {
+        m_target = target::TESTS;
+        m_hasTests = true;
+        m_tests.clear();
+      }
+      else if (!fileName.empty())
+      {
+        m_target = target::SOURCE;
+        m_sources.push_back(source{fileName, task::shm_string(shm().get_segment_manager())});
+      }
+      else 
+        m_target = target::NONE; // Other form fields are ignored
+      return true;
+    }
+    
+    bool part_data(const char* data, size_t len) override
+    {
+      if (target::SOURCE == m_target)
+        m_sources.back().content.append(data, data + len);
+      else if (target::TESTS == m_target)
+        m_tests.append(data, len);
+      return true;
+    }
+    
+    bool end_part() override
+    {
+      m_target = target::NONE;
+      return true;
+    }
+    
+    // Tests come in field named TESTS_FIELD_NAME, or as last file when client names fields differently
+    bool finish(bool needTests)
+    {
+      if (!needTests)
+        return !m_sources.empty();
+      if (!m_hasTests && m_sources.size() > 1)
+      {
+        m_tests.assign(m_sources.back().content.begin(), m_sources.back().content.end());
+        m_sources.pop_back();
+        m_hasTests = true;
+      }
+      return m_hasTests && !m_sources.empty();
+    }
+    
+    vector<source>& sources() { return m_sources; }
+    const string& tests() const { return m_tests; }
+  };
+  
+  // Parses multipart body of submission into collector and finds suite it's graded against (suite must be released)
+  int collect_submission(request_rec* r, submission_collector& collector, test_suite*& suite)
+  {
+    // Submission references registered suite or carries tests document
+    suite = nullptr;
+    string suiteHash = query_param(r, SUITE_NAME);
+    request_parser parser(r);
+    int httpCode = parser.parse(collector);
+    if (OK == httpCode && !collector.finish(suiteHash.empty()))
+      httpCode = HTTP_BAD_REQUEST;
+    if (OK != httpCode)
+    {
+      stringstream logmsg;
+      logmsg << "Bad POST request. Http code: " << httpCode;
+      LOG(logmsg.str(), grader::ERROR);
+      return httpCode;
+    }
+    
+    if (suiteHash.empty())
+    {
+      suite = test_suite::create(collector.tests().data(), collector.tests().size());
+      return suite ? OK : HTTP_INTERNAL_SERVER_ERROR;
+    }
+    if (test_suite::is_valid_hash(suiteHash.c_str()))
+      suite = test_suite::acquire(suiteHash.c_str());
+    if (!suite)
+    {
+      LOG(apr_pstrcat(r->pool, "Submission references unknown suite: ", suiteHash.c_str(), nullptr), grader::WARNING);
+      return HTTP_NOT_FOUND;
+    }
+    return OK;
+  }
+  
+  // Creates task and hands it over to grading daemon, task is null when it's rejected
+  int submit_task(request_rec* r, submission_collector::source& src, test_suite* suite, task*& newTask)
+  {
+    newTask = task::create_task(src.fileName.c_str(), src.fileName.size(), boost::move(src.content), suite);
+    if (!newTask)
+      return HTTP_INTERNAL_SERVER_ERROR;
+    if (task::state::INVALID == newTask->get_state())
+    {
+      task::destroy(newTask);
+      newTask = nullptr;
+      return HTTP_INTERNAL_SERVER_ERROR;
+    }
+    
+    // Client can ask for fresh grading even when same source was already graded (it shares only fresh runs then)
+    LOG(apr_pstrcat(r->pool, "Created task with id: ", newTask->id(), nullptr), grader::DEBUG);
+    if ("1" == query_param(r, "nocache"))
+      newTask->bypass_cache();
+    if (inflight_runs::instance().join(newTask))
+    {
+      // Identical submission is being graded right now, this task just shares its result
+      LOG(apr_pstrcat(r->pool, "Task with id: ", newTask->id(), " follows identical grading run", nullptr), grader::DEBUG);
+      return OK;
+    }
+    
+    // When queue is full we are overloaded
+    if (!job_queue::instance().try_push(newTask->id()))
+    {
+      LOG(apr_pstrcat(r->pool, "Job queue is full, rejecting task with id: ", newTask->id(), nullptr), grader::WARNING);
+      newTask->reject();
+      task::destroy(newTask);
+      newTask = nullptr;
+      return HTTP_SERVICE_UNAVAILABLE;
+    }
+    return OK;
+  }
+  
+  // Many sources graded against one tests document, tests are parsed once and shared by all created tasks
+  int batch_submit(request_rec* r)
+  {
+    submission_collector collector;
+    test_suite* suite;
+    int httpCode = collect_submission(r, collector, suite);
+    if (OK != httpCode)
+      return httpCode;
+    
+    // Response lists ids in same order as sources were sent (null for rejected ones)
+    auto& sources = collector.sources();
+    ap_rputs("[", r);
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+      task* newTask;
+      submit_task(r, sources[i], suite, newTask);
+      const char* separator = 0 == i ? " " : ", ";
+      if (newTask)
+        ap_rprintf(r, "%s\"%s\"", separator, newTask->id());
+      else
+        ap_rprintf(r, "%snull", separator);
+    }
+    ap_rputs(" ]", r);
+    
+    // Created tasks hold their own references
+    test_suite::release(suite);
+    return OK;
+  }
+}
+
 EXTERN_C void register_hooks(apr_pool_t* /*pool*/)
 {
   ap_hook_handler(grader_handler, NULL, NULL, APR_HOOK_LAST);
@@ -62,9 +429,6 @@ EXTERN_C int grader_handler(request_rec* r)
 {
   if (!r->handler || strcmp(r->handler, "grader")) return (DECLINED);
   
-  // Set signal handler to avoid zombie processes
-  signal(SIGCHLD, &avoid_zombie_handler);
-  
   /* Dispatch on type of request, when request type is POST
    assume that we have new grading to do, but if request type
    is GET assume that clients are asking for grading results */
@@ -72,11 +436,25 @@ EXTERN_C int grader_handler(request_rec* r)
   {
     LOG(apr_pstrcat(r->pool, "Accepted request; method: GET address: ", r->filename, nullptr), grader::DEBUG);
     char* taskId = task_id_from_url(r);
+    if (taskId && 0 == strcmp(taskId, STATS_NAME))
+      return stats(r);
     if (taskId && task::is_valid_task_name(taskId))
     {
-      auto foundTask = shm_find<task>(taskId);
+      // Task found here can be deleted by other request, but it isn't freed while it's pinned
+      task::pin foundTask(taskId);
       if (foundTask)
       {
+        // Streaming client gets all events of task, not just the current status
+        if ("1" == query_param(r, "stream"))
+        {
+          stream_events(r, foundTask.get());
+          return OK;
+        }
+        
+        // Long polling: block until state changes instead of making client poll again
+        auto waitMS = long_poll_ms(r);
+        if (0 != waitMS)
+          foundTask->wait_for_change(foundTask->get_state(), waitMS);
         ap_rprintf(r, "%s", foundTask->status());
       }
       else 
@@ -92,62 +470,54 @@ EXTERN_C int grader_handler(request_rec* r)
   else if (r->method_number == M_POST)
   {
     LOG(apr_pstrcat(r->pool, "Accepted request; method: POST address: ", r->filename, nullptr), grader::DEBUG);
-    request_parser parser(r);
-    request_parser::parsed_data data;
-    int httpCode = parser.parse(data);
+    
+    // POST to status.grade asks for statuses of many tasks at once
+    char* resourceName = task_id_from_url(r);
+    if (resourceName && 0 == strcmp(resourceName, BATCH_STATUS_NAME))
+      return batch_status(r);
+    if (resourceName && 0 == strcmp(resourceName, BATCH_SUBMIT_NAME))
+      return batch_submit(r);
+    
+    submission_collector collector;
+    test_suite* suite;
+    int httpCode = collect_submission(r, collector, suite);
     if (OK != httpCode)
-    {
-      stringstream logmsg;
-      logmsg << "Bad POST request. Http code: " << httpCode;
-      LOG(logmsg.str(), grader::ERROR);
       return httpCode;
-    }
-    task* newTask = task::create_task(get<request_parser::FILE_NAME>(data),
-                                      get<request_parser::FILE_NAME_LEN>(data),
-                                      get<request_parser::FILE_CONTENT>(data),
-                                      get<request_parser::FILE_CONTENT_LEN>(data),
-                                      get<request_parser::TESTS_CONTENT>(data),
-                                      get<request_parser::TESTS_CONTENT_LEN>(data));
-    if (!newTask || task::state::INVALID == newTask->get_state())
-    {
-      shm_destroy<task>(newTask->id());
-      return HTTP_INTERNAL_SERVER_ERROR;
-    }
-    
-    LOG(apr_pstrcat(r->pool, "Created task with id: ", newTask->id(), nullptr), grader::DEBUG);
-    int pid = fork();
-    if (-1 == pid)
+    if (1 != collector.sources().size())
     {
-      stringstream logmsg;
-      logmsg << "Forking child process to do task failed! Error msg: "
-             <<  strerror(errno);
-      LOG(logmsg.str(), grader::ERROR);
-      return HTTP_INTERNAL_SERVER_ERROR;
+      test_suite::release(suite);
+      return HTTP_BAD_REQUEST;
     }
     
-    // Child process
-    if (0 == pid)
-    {
-      newTask->run_all();
-      exit(EXIT_SUCCESS);
-    }
-    else 
-    { // Parent process
-      ap_rprintf(r, "%s", newTask->id());
-    }
+    // Hand task over to grading daemon, created task holds its own reference to suite
+    task* newTask;
+    httpCode = submit_task(r, collector.sources().front(), suite, newTask);
+    test_suite::release(suite);
+    if (OK != httpCode)
+      return httpCode;
+    ap_rprintf(r, "%s", newTask->id());
+  }
+  else if (r->method_number == M_PUT)
+  {
+    LOG(apr_pstrcat(r->pool, "Accepted request; method: PUT address: ", r->filename, nullptr), grader::DEBUG);
+    char* resourceName = task_id_from_url(r);
+    if (!resourceName || 0 != strcmp(resourceName, SUITE_NAME))
+      return (HTTP_NOT_FOUND);
+    return register_suite(r);
   }
   else if (r->method_number == M_DELETE)
   {
     LOG(apr_pstrcat(r->pool, "Accepted request; method: DELETE address: ", r->filename, nullptr), grader::DEBUG);
     char* taskId = task_id_from_url(r);
+    if (taskId && 0 == strcmp(taskId, SUITE_NAME))
+      return unregister_suite(r);
     if (taskId && task::is_valid_task_name(taskId))
     {
-      auto foundTask = shm_find<task>(taskId);
-      if (foundTask && (task::state::FINISHED == foundTask->get_state() ||
-                        task::state::COMPILE_ERROR == foundTask->get_state() ||
-                        task::state::INVALID == foundTask->get_state()))
+      epoch_manager::guard readGuard;
+      auto foundTask = task::find(taskId);
+      if (foundTask && task::is_terminal(foundTask->get_state()) && !foundTask->has_waiters())
       {
-        shm_destroy<task>(taskId);
+        task::destroy(foundTask);
         ap_rprintf(r, "{ \"STATE\" : \"DESTROYED\" }");
       }
       else 
@@ -167,9 +537,3 @@ EXTERN_C int grader_handler(request_rec* r)
   }
   return OK;
 }
-
-void avoid_zombie_handler(int)
-{
-  int childStatus;
-  wait(&childStatus);
-}
@@ -0,0 +1,208 @@
+// Project headers
+#include "multipart_parser.hpp"
+
+// STL headers
+#include <algorithm>
+#include <cstring>
+
+// BOOST headers
+#include <boost/algorithm/string/predicate.hpp>
+
+using namespace std;
+
+namespace grader
+{
+  constexpr size_t multipart_parser::MAX_HEADERS_LENGTH;
+
+  multipart_parser::multipart_parser(const char* boundary, size_t boundaryLen, multipart_parser::handler& h)
+  : m_delimiter("\r\n"), m_pending("\r\n"), m_handler(h), m_state(state::PREAMBLE)
+  {
+    // Body starts with boundary without line break, pending line break makes it look as any other delimiter
+    m_delimiter.append(boundary, boundaryLen);
+  }
+
+  bool multipart_parser::feed(const char* data, size_t len)
+  {
+    // Anything after closing delimiter is epilogue and it's ignored
+    const char* end = data + len;
+    while (data != end && state::DONE != m_state && state::ERROR != m_state)
+    {
+      switch (m_state)
+      {
+        case state::PREAMBLE:
+        case state::CONTENT:
+          data = feed_content(data, end);
+          break;
+        case state::AFTER_DELIMITER:
+          data = feed_after_delimiter(data, end);
+          break;
+        case state::HEADERS:
+          data = feed_headers(data, end);
+          break;
+        case state::DONE:
+        case state::ERROR:
+          break;
+      }
+    }
+    return state::ERROR != m_state;
+  }
+
+  const char* multipart_parser::feed_content(const char* data, const char* end)
+  {
+    // Continue delimiter that started at the end of previous chunk
+    if (!m_pending.empty())
+    {
+      auto matched = m_pending.size();
+      auto needed = m_delimiter.size() - matched;
+      auto available = min<size_t>(needed, end - data);
+      if (equal(data, data + available, m_delimiter.begin() + matched))
+      {
+        if (available < needed)
+        {
+          m_pending.append(data, available);
+          return end;
+        }
+        m_pending.clear();
+        return end_of_part(data + available);
+      }
+
+      // Held bytes were content after all ('\r' is only first char of delimiter, so no other match starts in them)
+      string held;
+      held.swap(m_pending);
+      if (!content(held.data(), held.size()))
+        return fail();
+    }
+
+    auto found = search(data, end, m_delimiter.begin(), m_delimiter.end());
+    if (found != end)
+    {
+      if (!content(data, found - data))
+        return fail();
+      return end_of_part(found + m_delimiter.size());
+    }
+
+    // Hold back tail of chunk that can be beginning of delimiter
+    auto tail = end - min<size_t>(end - data, m_delimiter.size() - 1);
+    for (tail = find(tail, end, '\r'); tail != end; tail = find(tail + 1, end, '\r'))
+    {
+      if (equal(tail, end, m_delimiter.begin()))
+        break;
+    }
+    if (!content(data, tail - data))
+      return fail();
+    m_pending.assign(tail, end);
+    return end;
+  }
+
+  const char* multipart_parser::feed_after_delimiter(const char* data, const char* end)
+  {
+    // Delimiter is followed by line break (next part) or by "--" (end of body)
+    while (data != end && m_headers.size() < 2)
+      m_headers.push_back(*data++);
+    if (m_headers.size() < 2)
+      return end;
+
+    if ("--" == m_headers)
+      m_state = state::DONE;
+    else if ("\r\n" == m_headers)
+      m_state = state::HEADERS;
+    else
+      return fail();
+
+    // Headers are collected with leading line break, so part without headers also ends with empty line
+    m_headers.assign("\r\n");
+    return data;
+  }
+
+  const char* multipart_parser::feed_headers(const char* data, const char* end)
+  {
+    // Collect headers until empty line (searching only from where previous chunk ended)
+    static const char emptyLine[] = "\r\n\r\n";
+    auto oldSize = m_headers.size();
+    auto take = min<size_t>(end - data, MAX_HEADERS_LENGTH + 1 - min(oldSize, MAX_HEADERS_LENGTH));
+    m_headers.append(data, take);
+    auto searchFrom = m_headers.begin() + (oldSize - min<size_t>(oldSize, 3));
+    auto found = search(searchFrom, m_headers.end(), emptyLine, emptyLine + 4);
+    if (found == m_headers.end())
+    {
+      if (m_headers.size() > MAX_HEADERS_LENGTH)
+        return fail();
+      return end;
+    }
+    auto consumed = (found - m_headers.begin()) + 4 - oldSize;
+    m_headers.erase(found, m_headers.end());
+
+    // Part is identified by Content-Disposition parameters (file name is empty for simple fields)
+    const char* name = nullptr,* fileName = nullptr;
+    size_t nameLen = 0, fileNameLen = 0;
+    auto headersBegin = m_headers.data();
+    auto headersEnd = headersBegin + m_headers.size();
+    const char* line = headersBegin;
+    while (line != headersEnd)
+    {
+      auto lineEnd = search(line, headersEnd, emptyLine, emptyLine + 2);
+      if (boost::istarts_with(string(line, lineEnd), "Content-Disposition:"))
+      {
+        header_param(line, lineEnd, "name", name, nameLen);
+        header_param(line, lineEnd, "filename", fileName, fileNameLen);
+        break;
+      }
+      line = lineEnd == headersEnd ? lineEnd : lineEnd + 2;
+    }
+    if (!name || !m_handler.begin_part(string(name, nameLen), fileName ? string(fileName, fileNameLen) : string()))
+      return fail();
+
+    m_headers.clear();
+    m_state = state::CONTENT;
+    return data + consumed;
+  }
+
+  const char* multipart_parser::end_of_part(const char* next)
+  {
+    if (state::CONTENT == m_state && !m_handler.end_part())
+      return fail();
+    m_headers.clear();
+    m_state = state::AFTER_DELIMITER;
+    return next;
+  }
+
+  bool multipart_parser::content(const char* data, size_t len)
+  {
+    // Preamble (text before first boundary) is ignored
+    if (state::PREAMBLE == m_state || 0 == len)
+      return true;
+    return m_handler.part_data(data, len);
+  }
+
+  const char* multipart_parser::fail()
+  {
+    m_state = state::ERROR;
+    return nullptr;
+  }
+
+  bool multipart_parser::header_param(const char* begin, const char* end, const char* param, const char*& value, size_t& valueLen)
+  {
+    auto paramLen = strlen(param);
+    for (auto it = begin; end != (it = search(it, end, param, param + paramLen)); ++it)
+    {
+      // Parameter must be whole word ('name' is also suffix of 'filename'), spaces around '=' are tolerated
+      if (it != begin && !(' ' == it[-1] || ';' == it[-1] || '\t' == it[-1]))
+        continue;
+      auto eq = it + paramLen;
+      while (eq != end && (' ' == *eq || '\t' == *eq)) ++eq;
+      if (eq == end || '=' != *eq)
+        continue;
+      ++eq;
+      while (eq != end && (' ' == *eq || '\t' == *eq)) ++eq;
+      if (eq == end || '\"' != *eq)
+        continue;
+      auto valueEnd = find(eq + 1, end, '\"');
+      if (valueEnd == end)
+        return false;
+      value = eq + 1;
+      valueLen = valueEnd - value;
+      return true;
+    }
+    return false;
+  }
+}
@@ -36,6 +36,8 @@
 #include <http_protocol.h>
 #include <http_request.h>
 #include <apr_strings.h>
+#include <apr_buckets.h>
+#include <util_filter.h>
 
 using namespace std;
 
@@ -46,67 +48,58 @@ namespace grader
   {
   }
 
-  int request_parser::parse(request_parser::parsed_data& toFill) const
+  int request_parser::parse(multipart_parser::handler& h) const
   {
-    // Read boundary and body
-    size_t boundaryLen, bodyLen;
-    char* boundary,* body;
-    boundary = get_boundary(boundaryLen);
-    int httpCode = read_body(body, bodyLen);
+    size_t boundaryLen;
+    char* boundary = get_boundary(boundaryLen);
     if (!boundary)
       return (HTTP_BAD_REQUEST);
-    if ((OK) != httpCode)
-      return httpCode;
+    multipart_parser parser(boundary, boundaryLen, h);
     
-    // Example of body starts with next three lines:
-    //   -----------------------------75180758514773109461831266709 /*this is boundary*/
-    //   Content-Disposition: form-data; name="fileToUpload"; filename="main.cpp" 
-    //   Content-Type: text/x-c++src
-    // To parse data we can skip first 'boundaryLen' bytes and then extract first line.
-    // From that line we want to fetch value of filename. Next, we get to the last line
-    // and move past it. Until we reach a new boundary we read all that data as a file data.
-    
-    // Skip boundary
-    body += boundaryLen;
-    while (*body == '\n' || *body == '\r') ++body;
-    
-    // Find file name attribute
-    auto range = boost::ifind_first(body, "filename=\"");
-    if (range.empty()) return (HTTP_BAD_REQUEST);
-    
-    // Initialize file name and size
-    char* filename = range.end();
-    get<FILE_NAME>(toFill) = filename;
-    while (*filename != '\"') ++filename;
-    get<FILE_NAME_LEN>(toFill) = static_cast<size_t>(filename - range.end());
-    
-    // Skip two lines (this line and Content-Type line)
-    body = filename + 1;
-    while (*body != '\n' && *body != '\r') ++body; // Move to the end of line
-    while (*body == '\n' || *body == '\r') ++body; // Move to next line skipping new line chars (skipped FIRST line at the end)
-    while (*body != '\n' && *body != '\r') ++body; // Move to the end of line
-    while (*body == '\n' || *body == '\r') ++body; // Move to next line skipping new line chars (skipped TWO lines in total)
-    
-    // Find next boundary, that will be end of file. File begins at 'body'
-    get<FILE_CONTENT>(toFill) = body;
-    range = boost::find_first(body, boundary);
-    get<FILE_CONTENT_LEN>(toFill) = range.begin() - get<FILE_CONTENT>(toFill);
-    
-    // Move to the next line
-    body = range.end();
-    while (*body == '\n' || *body == '\r') ++body;
-    
-    // Skip 2 lines
-    while (*body != '\n' && *body != '\r') ++body; // Move to the end of line
-    while (*body == '\n' || *body == '\r') ++body; // Move to next line skipping new line chars (skipped FIRST line at the end)
-    while (*body != '\n' && *body != '\r') ++body; // Move to the end of line
-    while (*body == '\n' || *body == '\r') ++body; // Move to next line skipping new line chars (skipped TWO lines in total)
-    
-    // Find next boundary, content of tests.xml begins at 'body'
-    get<TESTS_CONTENT>(toFill) = body;
-    range = boost::find_first(body, boundary);
-    get<TESTS_CONTENT_LEN>(toFill) = range.begin() - get<TESTS_CONTENT>(toFill);
-    return 0;
+    // Feed buckets to parser as they come, data stays in buckets (nothing is copied to intermediate buffer)
+    apr_bucket_brigade* bb = apr_brigade_create(m_r->pool, m_r->connection->bucket_alloc);
+    size_type bodyLen = 0;
+    bool seenEOS = false;
+    while (!seenEOS)
+    {
+      apr_status_t rv = ap_get_brigade(m_r->input_filters, bb, AP_MODE_READBYTES, APR_BLOCK_READ, READ_CHUNK_SIZE);
+      if (APR_SUCCESS != rv)
+      {
+        apr_brigade_destroy(bb);
+        return (HTTP_BAD_REQUEST);
+      }
+      
+      for (apr_bucket* b = APR_BRIGADE_FIRST(bb); b != APR_BRIGADE_SENTINEL(bb); b = APR_BUCKET_NEXT(b))
+      {
+        if (APR_BUCKET_IS_EOS(b))
+        {
+          seenEOS = true;
+          break;
+        }
+        if (APR_BUCKET_IS_METADATA(b))
+          continue;
+        
+        const char* data;
+        apr_size_t len;
+        rv = apr_bucket_read(b, &data, &len, APR_BLOCK_READ);
+        bodyLen += len;
+        int httpCode = (OK);
+        if (APR_SUCCESS != rv)
+          httpCode = (HTTP_BAD_REQUEST);
+        else if (bodyLen > MAX_BODY_LENGTH)
+          httpCode = (HTTP_REQUEST_ENTITY_TOO_LARGE);
+        else if (!parser.feed(data, len))
+          httpCode = (HTTP_BAD_REQUEST);
+        if ((OK) != httpCode)
+        {
+          apr_brigade_destroy(bb);
+          return httpCode;
+        }
+      }
+      apr_brigade_cleanup(bb);
+    }
+    apr_brigade_destroy(bb);
+    return parser.finish() ? (OK) : (HTTP_BAD_REQUEST);
   }
   
   int request_parser::read_body(char*& rbuf, std::size_t& rbufLen) const
@@ -114,6 +107,8 @@ namespace grader
     /*~~~~~~~~*/
       int rc = OK;
       /*~~~~~~~~*/
+      rbuf = nullptr;
+      rbufLen = 0;
 
       if((rc = ap_setup_client_block(m_r, REQUEST_CHUNKED_ERROR))) {
           return(rc);
@@ -22,7 +22,23 @@ namespace grader_test
   {
   }
 
-  string http_tester::submit(const string& sourceName, const string& testName)
+  string http_tester::submit(const string& sourceName, const string& testName, const string& query)
+  {
+    return post_sources(query.empty() ? m_url : m_url + "?" + query, vector<string>{sourceName}, testName);
+  }
+  
+  string http_tester::submit_batch(const vector<string>& sourceNames, const string& testName, const string& query)
+  {
+    return post_sources(query.empty() ? "/batch.grade" : "/batch.grade?" + query, sourceNames, testName);
+  }
+
+  string http_tester::submit_to_suite(const string& sourceName, const string& suiteHash)
+  {
+    // Tests are already on server, so only source is sent
+    return post_sources(m_url + "?suite=" + suiteHash, vector<string>{sourceName}, "");
+  }
+
+  string http_tester::post_sources(const string& url, const vector<string>& sourceNames, const string& testName)
   {
     using boost::asio::ip::tcp;
     boost::asio::io_service ioService;
@@ -41,11 +57,11 @@ namespace grader_test
     ostream requestStream(&request);
     ostringstream bodyStream;
     streampos beginBodyStream = bodyStream.tellp();
-    string boundary = fill_request_data(sourceName, testName, bodyStream);
+    string boundary = fill_request_data(sourceNames, testName, bodyStream);
     auto contentLen = bodyStream.tellp() - beginBodyStream;
     
     // Fill request headers and copy body from bodyStream
-    requestStream << "POST " << m_url << " HTTP/1.1\r\n";
+    requestStream << "POST " << url << " HTTP/1.1\r\n";
     requestStream << "Host: " << m_server << "\r\n";
     requestStream << "Accept: */*\r\n";
     requestStream << "Content-Type: " << "multipart/form-data; "
@@ -59,7 +75,7 @@ namespace grader_test
     return move(body_as_string(socket));
   }
 
-  string http_tester::fetch_status(const string& taskId) const
+  string http_tester::fetch_status(const string& taskId, unsigned waitMS) const
   {
     using boost::asio::ip::tcp;
     boost::asio::io_service ioService;
@@ -76,7 +92,10 @@ namespace grader_test
     // Create request stream
     boost::asio::streambuf request;
     ostream requestStream(&request);
-    requestStream << "GET /" << taskId << '.' << "grade " << "HTTP/1.1\r\n";
+    requestStream << "GET /" << taskId << '.' << "grade";
+    if (0 != waitMS)
+      requestStream << "?wait=" << waitMS;
+    requestStream << " HTTP/1.1\r\n";
     requestStream << "Host: " << m_server << "\r\n";
     requestStream << "Accept: */*\r\n";
     requestStream << "Connection: close\r\n\r\n";
@@ -86,6 +105,68 @@ namespace grader_test
     return move(body_as_string(socket));
   }
   
+  string http_tester::fetch_statuses(const vector<string>& taskIds) const
+  {
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ioService;
+    
+    // Get a list of endpoints corresponding to the server name.
+    tcp::resolver resolver(ioService);
+    tcp::resolver::query query(m_server, "http");
+    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+
+    // Try each endpoint until we successfully establish a connection.
+    tcp::socket socket(ioService);
+    boost::asio::connect(socket, endpointIterator);
+    
+    // Ids are sent one per line
+    string body;
+    for (const auto& taskId : taskIds)
+      body += taskId + "\n";
+    
+    // Create request stream
+    boost::asio::streambuf request;
+    ostream requestStream(&request);
+    requestStream << "POST /status.grade HTTP/1.1\r\n";
+    requestStream << "Host: " << m_server << "\r\n";
+    requestStream << "Accept: */*\r\n";
+    requestStream << "Content-Type: text/plain\r\n";
+    requestStream << "Content-Length: " << body.size() << "\r\n";
+    requestStream << "Connection: close\r\n\r\n";
+    requestStream << body;
+    
+    // Send request and return response body
+    boost::asio::write(socket, request);
+    return move(body_as_string(socket));
+  }
+  
+  string http_tester::stream_events(const string& taskId) const
+  {
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ioService;
+    
+    // Get a list of endpoints corresponding to the server name.
+    tcp::resolver resolver(ioService);
+    tcp::resolver::query query(m_server, "http");
+    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+
+    // Try each endpoint until we successfully establish a connection.
+    tcp::socket socket(ioService);
+    boost::asio::connect(socket, endpointIterator);
+    
+    // Create request stream
+    boost::asio::streambuf request;
+    ostream requestStream(&request);
+    requestStream << "GET /" << taskId << ".grade?stream=1 HTTP/1.1\r\n";
+    requestStream << "Host: " << m_server << "\r\n";
+    requestStream << "Accept: text/event-stream\r\n";
+    requestStream << "Connection: close\r\n\r\n";
+    
+    // Send request and return whole stream (server closes it once task reaches final state)
+    boost::asio::write(socket, request);
+    return move(body_as_string(socket));
+  }
+  
   string http_tester::delete_task(const string& taskId) const
   {
     using boost::asio::ip::tcp;
@@ -113,26 +194,95 @@ namespace grader_test
     return move(body_as_string(socket));
   }
   
-  string http_tester::fill_request_data(const string& sourceName, const string& testName, ostream& bodyStream) const
+  string http_tester::upload_suite(const string& testName) const
   {
-    // Create multipart header for source file
-    string boundary = create_boundary();
-    bodyStream << "--" << boundary << "\r\n";
-    bodyStream << "Content-Disposition: form-data; name =\"fileToUpload\"; filename=\"" << sourceName << "\"\r\n";
-    bodyStream << "Content-Type: " << m_srcMimeType << "\r\n\r\n";
-    
-    // Read source file into stream
-    ifstream srcFileStream(m_baseDir + '/' + sourceName);
-    bodyStream << srcFileStream.rdbuf() << "\r\n";
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ioService;
     
-    // Create multipart header for test file
-    bodyStream << "--" << boundary << "\r\n";
-    bodyStream << "Content-Disposition: form-data; name =\"xmlToUpload\"; filename=\"" << testName << "\"\r\n";
-    bodyStream << "Content-Type: " << "text/xml\r\n\r\n";
+    // Get a list of endpoints corresponding to the server name.
+    tcp::resolver resolver(ioService);
+    tcp::resolver::query query(m_server, "http");
+    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+
+    // Try each endpoint until we successfully establish a connection.
+    tcp::socket socket(ioService);
+    boost::asio::connect(socket, endpointIterator);
     
-    // Read test file into stream
+    // Tests document is whole body
     ifstream testFileStream(m_baseDir + '/' + testName);
-    bodyStream << testFileStream.rdbuf() << "\r\n";
+    ostringstream bodyStream;
+    bodyStream << testFileStream.rdbuf();
+    string body = bodyStream.str();
+    
+    // Create request stream
+    boost::asio::streambuf request;
+    ostream requestStream(&request);
+    requestStream << "PUT /suite.grade HTTP/1.1\r\n";
+    requestStream << "Host: " << m_server << "\r\n";
+    requestStream << "Accept: */*\r\n";
+    requestStream << "Content-Type: text/xml\r\n";
+    requestStream << "Content-Length: " << body.size() << "\r\n";
+    requestStream << "Connection: close\r\n\r\n";
+    requestStream << body;
+    
+    // Send request and return response body
+    boost::asio::write(socket, request);
+    return move(body_as_string(socket));
+  }
+  
+  string http_tester::delete_suite(const string& suiteHash) const
+  {
+    using boost::asio::ip::tcp;
+    boost::asio::io_service ioService;
+    
+    // Get a list of endpoints corresponding to the server name.
+    tcp::resolver resolver(ioService);
+    tcp::resolver::query query(m_server, "http");
+    tcp::resolver::iterator endpointIterator = resolver.resolve(query);
+
+    // Try each endpoint until we successfully establish a connection.
+    tcp::socket socket(ioService);
+    boost::asio::connect(socket, endpointIterator);
+    
+    // Create request stream
+    boost::asio::streambuf request;
+    ostream requestStream(&request);
+    requestStream << "DELETE /suite.grade?suite=" << suiteHash << " HTTP/1.1\r\n";
+    requestStream << "Host: " << m_server << "\r\n";
+    requestStream << "Accept: */*\r\n";
+    requestStream << "Connection: close\r\n\r\n";
+    
+    // Send request and return response body
+    boost::asio::write(socket, request);
+    return move(body_as_string(socket));
+  }
+  
+  string http_tester::fill_request_data(const vector<string>& sourceNames, const string& testName, ostream& bodyStream) const
+  {
+    string boundary = create_boundary();
+    for (const auto& sourceName : sourceNames)
+    {
+      // Create multipart header for source file
+      bodyStream << "--" << boundary << "\r\n";
+      bodyStream << "Content-Disposition: form-data; name =\"fileToUpload\"; filename=\"" << sourceName << "\"\r\n";
+      bodyStream << "Content-Type: " << m_srcMimeType << "\r\n\r\n";
+      
+      // Read source file into stream
+      ifstream srcFileStream(m_baseDir + '/' + sourceName);
+      bodyStream << srcFileStream.rdbuf() << "\r\n";
+    }
+    
+    // Create multipart header for test file (registered suite is referenced from URL instead)
+    if (!testName.empty())
+    {
+      bodyStream << "--" << boundary << "\r\n";
+      bodyStream << "Content-Disposition: form-data; name =\"xmlToUpload\"; filename=\"" << testName << "\"\r\n";
+      bodyStream << "Content-Type: " << "text/xml\r\n\r\n";
+      
+      // Read test file into stream
+      ifstream testFileStream(m_baseDir + '/' + testName);
+      bodyStream << testFileStream.rdbuf() << "\r\n";
+    }
     bodyStream << "--" << boundary << "--";
     return move(boundary);
   }
@@ -168,7 +318,7 @@ namespace grader_test
     // Read whole body
     boost::system::error_code code;
     while (boost::asio::read(socket, responseBuff, boost::asio::transfer_at_least(1), code))
-      std::cout << &responseBuff;
+      retStream << &responseBuff;
     
     // In case of error throw exception
     if (code != boost::asio::error::eof)
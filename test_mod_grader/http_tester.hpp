@@ -3,6 +3,7 @@
 
 // STL headers
 #include <string>
+#include <vector>
 
 // BOOST headers
 #include <boost/asio.hpp>
@@ -19,8 +20,15 @@ namespace grader_test
     http_tester(const std::string& server, const std::string& base_dir, const std::string& srcMimeType, 
                 const std::string& url = "/upload.grade");
     
-    std::string submit(const std::string& sourceName, const std::string& testName);
-    std::string fetch_status(const std::string& taskId) const;
+    std::string submit(const std::string& sourceName, const std::string& testName, const std::string& query = "");
+    std::string submit_batch(const std::vector<std::string>& sourceNames, const std::string& testName,
+                             const std::string& query = "");
+    std::string submit_to_suite(const std::string& sourceName, const std::string& suiteHash);
+    std::string upload_suite(const std::string& testName) const;
+    std::string delete_suite(const std::string& suiteHash) const;
+    std::string fetch_status(const std::string& taskId, unsigned waitMS = 0) const;
+    std::string fetch_statuses(const std::vector<std::string>& taskIds) const;
+    std::string stream_events(const std::string& taskId) const;
     std::string delete_task(const std::string& taskId) const;
     
     // Server get/set
@@ -39,7 +47,8 @@ namespace grader_test
     const std::string& url() const { return m_url; }
     std::string& url() { return m_url; }
   private:
-    std::string fill_request_data(const std::string& sourceName, const std::string& testName, std::ostream& bodyStream) const;
+    std::string post_sources(const std::string& url, const std::vector<std::string>& sourceNames, const std::string& testName);
+    std::string fill_request_data(const std::vector<std::string>& sourceNames, const std::string& testName, std::ostream& bodyStream) const;
     std::string create_boundary() const;
     std::string body_as_string(boost::asio::ip::tcp::socket& socket) const;
   };
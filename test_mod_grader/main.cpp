@@ -2,18 +2,20 @@
 #include "http_tester.hpp"
 
 // STL headers
+#include <algorithm>
 #include <string>
 #include <sstream>
-#include <thread>
-#include <chrono>
+#include <vector>
 
 // BOOST headers
 #define BOOST_TEST_MODULE example
 #include <boost/test/included/unit_test.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include <boost/filesystem.hpp>
 
 // Testing headers
+#include "../mod_grader/include/core/configuration.hpp"
 #include "../mod_grader/include/core/task.hpp"
 
 using namespace std;
@@ -21,7 +23,82 @@ using namespace grader_test;
 using namespace boost::property_tree;
 
 const std::string base_dir = "../../mod_grader/src/examples/c";
+const std::string generators_dir = "../../mod_grader/src/examples/generators";
 http_tester tester("localhost", base_dir, "text/x-csrc");
+const unsigned LONG_POLL_MS = 5000;
+const size_t SMALL_PROGRAM_RSS_KB = 16 * 1024; // Examples are tiny, grader's own memory must not show up in their peak
+
+// Counter from GET /stats.grade, path is like "RESULT_CACHE.HITS"
+inline unsigned long stats_counter(const string& path)
+{
+  istringstream statsStream(tester.fetch_status("stats"));
+  ptree stats;
+  json_parser::read_json(statsStream, stats);
+  return stats.get<unsigned long>(path);
+}
+
+// Events of task's stream, every event is JSON object carried in data fields of one SSE message
+inline vector<ptree> stream_events(const string& taskId)
+{
+  istringstream streamStream(tester.stream_events(taskId));
+  vector<ptree> events;
+  string line, data;
+  while (getline(streamStream, line))
+  {
+    if (0 == line.compare(0, 6, "data: "))
+      data += line.substr(6) + "\n";
+    else if (line.empty() && !data.empty())
+    {
+      istringstream eventStream(data);
+      events.emplace_back();
+      json_parser::read_json(eventStream, events.back());
+      data.clear();
+    }
+  }
+  return events;
+}
+
+// Status of task once it reaches final state (server answers as soon as task state changes)
+inline ptree wait_for_final_status(const string& taskId)
+{
+  ptree taskResult;
+  string taskState;
+  do {
+    taskResult.clear();
+    istringstream taskStatusStream(tester.fetch_status(taskId, LONG_POLL_MS));
+    json_parser::read_json(taskStatusStream, taskResult);
+    taskState = taskResult.get<string>("STATE");
+  } while ("WAITING" == taskState || "COMPILING" == taskState || "RUNNING" == taskState);
+  return taskResult;
+}
+
+// Every test of task has its own event before event of final state
+inline void check_test_events(const vector<ptree>& events, size_t testsCount)
+{
+  BOOST_REQUIRE(!events.empty());
+  BOOST_CHECK_EQUAL(events.back().get<string>("STATE", ""), "FINISHED");
+  for (size_t i = 0; i < testsCount; ++i)
+  {
+    string testName = "TEST" + to_string(i);
+    auto eventIt = find_if(events.cbegin(), events.cend() - 1, [&](const ptree& event)
+    {
+      return event.get_child_optional(testName) && event.get_child_optional("METRICS");
+    });
+    BOOST_CHECK_MESSAGE(events.cend() - 1 != eventIt, "No event for " << testName);
+  }
+}
+
+// Example with tests document of same name has one test, its verdict is checked
+inline void test_single_verdict(const string& exampleName, const string& verdict)
+{
+  string taskId = tester.submit(exampleName + ".c", exampleName + ".xml", "nocache=1");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  ptree taskResult = wait_for_final_status(taskId);
+  BOOST_CHECK_EQUAL(taskResult.get<string>("STATE"), "FINISHED");
+  BOOST_CHECK_MESSAGE(verdict == taskResult.get<string>("TEST0", ""), 
+                      exampleName << " got verdict " << taskResult.get<string>("TEST0", "") << " instead of " << verdict);
+  tester.delete_task(taskId);
+}
 
 inline void test_standard_case(const string& srcName, const string& testName, const ptree& correctResult)
 {
@@ -29,14 +106,11 @@ inline void test_standard_case(const string& srcName, const string& testName, co
   string taskId = tester.submit(srcName, testName);
   BOOST_CHECK(grader::task::is_valid_task_name(taskId.c_str()));
   
-  // Pool for finished task
+  // Poll for finished task
   ptree taskResult;
   do {
-    // Wait a little
-    this_thread::sleep_for(chrono::milliseconds(300));
-    
-    // Get task status
-    string body = tester.fetch_status(taskId);
+    // Get task status (server answers as soon as task state changes)
+    string body = tester.fetch_status(taskId, LONG_POLL_MS);
     istringstream taskStatusStream(body);
     json_parser::read_json(taskStatusStream, taskResult);
     string taskState = taskResult.get<string>("STATE");
@@ -51,7 +125,19 @@ inline void test_standard_case(const string& srcName, const string& testName, co
     taskResult.clear();
   } while (true);
   
-  // Check task result
+  // Check that every test has resource metrics and then check task result without them
+  auto metrics = taskResult.get_child_optional("METRICS");
+  BOOST_REQUIRE(metrics);
+  BOOST_CHECK_EQUAL(metrics->size(), correctResult.size() - 1);
+  for (const auto& testMetrics : *metrics)
+  {
+    BOOST_CHECK(testMetrics.second.get_child_optional("WALL_MS"));
+    BOOST_CHECK(testMetrics.second.get_child_optional("CPU_MS"));
+    BOOST_CHECK(testMetrics.second.get_child_optional("PEAK_RSS_KB"));
+    BOOST_CHECK_LT(testMetrics.second.get<size_t>("PEAK_RSS_KB", SMALL_PROGRAM_RSS_KB), SMALL_PROGRAM_RSS_KB);
+    BOOST_CHECK(testMetrics.second.get_child_optional("SIGNAL"));
+  }
+  taskResult.erase("METRICS");
   BOOST_CHECK(correctResult == taskResult);
   
   // Delete finished task
@@ -132,20 +218,286 @@ BOOST_AUTO_TEST_CASE( file_file )
   test_standard_case("file_file.c", "file_file.xml", correctResult);
 }
 
+BOOST_AUTO_TEST_CASE( checkers )
+{
+  // Example echoes input, so every test compares its own output: exact keeps CR and inner whitespace,
+  // tokens ignore both (tokens also cross 16 byte blocks), floats are equal within tolerance
+  ptree correctResult;
+  correctResult.put("STATE", "FINISHED");
+  correctResult.put("TEST0", "1");
+  correctResult.put("TEST1", "0");
+  correctResult.put("TEST2", "0");
+  correctResult.put("TEST3", "1");
+  correctResult.put("TEST4", "0");
+  correctResult.put("TEST5", "1");
+  correctResult.put("TEST6", "1");
+  correctResult.put("TEST7", "1");
+  correctResult.put("TEST8", "0");
+  
+  test_standard_case("checkers.c", "checkers.xml", correctResult);
+}
+
+BOOST_AUTO_TEST_CASE( batch )
+{
+  // Submit same tests with three sources, every source gets its own task
+  istringstream idsStream(tester.submit_batch({"std_std.c", "compiler_err.c", "std_std.c"}, "std_std.xml"));
+  ptree ids;
+  json_parser::read_json(idsStream, ids);
+  BOOST_REQUIRE_EQUAL(ids.size(), 3U);
+  vector<string> taskIds;
+  for (const auto& id : ids)
+  {
+    taskIds.push_back(id.second.get_value<string>());
+    BOOST_CHECK(grader::task::is_valid_task_name(taskIds.back().c_str()));
+  }
+  
+  // Wait until all tasks reach final state, tasks share tests (and identical sources share grading run)
+  vector<string> expectedStates{"FINISHED", "COMPILE_ERROR", "FINISHED"};
+  for (size_t i = 0; i < taskIds.size(); ++i)
+  {
+    ptree taskResult = wait_for_final_status(taskIds[i]);
+    string taskState = taskResult.get<string>("STATE");
+    BOOST_CHECK_EQUAL(taskState, expectedStates[i]);
+    if ("FINISHED" == taskState)
+    {
+      BOOST_CHECK_EQUAL(taskResult.get<string>("TEST0"), "1");
+      BOOST_CHECK_EQUAL(taskResult.get<string>("TEST1"), "1");
+      BOOST_CHECK_EQUAL(taskResult.get<string>("TEST2"), "1");
+    }
+    tester.delete_task(taskIds[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( registered_suite )
+{
+  // Upload tests once, suite is referenced by its hash
+  istringstream suiteStream(tester.upload_suite("std_std.xml"));
+  ptree suiteResult;
+  json_parser::read_json(suiteStream, suiteResult);
+  string suiteHash = suiteResult.get<string>("SUITE");
+  BOOST_REQUIRE_EQUAL(suiteHash.size(), 40U);
+  
+  // Submission carries only source
+  string taskId = tester.submit_to_suite("std_std.c", suiteHash);
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  ptree taskResult = wait_for_final_status(taskId);
+  BOOST_CHECK_EQUAL(taskResult.get<string>("STATE"), "FINISHED");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST0"), "1");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST1"), "1");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST2"), "1");
+  tester.delete_task(taskId);
+  
+  // Unregistered suite can't be referenced anymore
+  istringstream deletitionResultStream(tester.delete_suite(suiteHash));
+  ptree deletitionResult;
+  json_parser::read_json(deletitionResultStream, deletitionResult);
+  BOOST_CHECK_EQUAL(deletitionResult.get<string>("STATE"), "DESTROYED");
+  istringstream secondDeletitionStream(tester.delete_suite(suiteHash));
+  deletitionResult.clear();
+  json_parser::read_json(secondDeletitionStream, deletitionResult);
+  BOOST_CHECK_EQUAL(deletitionResult.get<string>("STATE"), "NOT_FOUND");
+}
+
+BOOST_AUTO_TEST_CASE( compiled_suite )
+{
+  // With SUITE_DIR (grader runs on this machine) tests are compiled to file named by suite hash,
+  // file and standard I/O tests are then fed from mapped file
+  istringstream suiteStream(tester.upload_suite("file_file.xml"));
+  ptree suiteResult;
+  json_parser::read_json(suiteStream, suiteResult);
+  string suiteHash = suiteResult.get<string>("SUITE");
+  BOOST_REQUIRE_EQUAL(suiteHash.size(), 40U);
+  BOOST_CHECK_EQUAL(suiteResult.get<string>("STATE"), "READY");
+  
+  const grader::configuration& conf = grader::configuration::instance();
+  auto suiteDirIt = conf.get(grader::configuration::SUITE_DIR);
+  if (conf.invalid() != suiteDirIt && !suiteDirIt->second.empty())
+  {
+    namespace fs = boost::filesystem;
+    auto suiteFileIt = find_if(fs::directory_iterator(suiteDirIt->second), fs::directory_iterator(), 
+                               [&](const fs::directory_entry& entry)
+    {
+      return 0 == entry.path().filename().string().compare(0, suiteHash.size() + 1, suiteHash + "-");
+    });
+    BOOST_CHECK_MESSAGE(fs::directory_iterator() != suiteFileIt, "No compiled file of suite " << suiteHash);
+  }
+  else
+    BOOST_TEST_MESSAGE("SUITE_DIR isn't configured, tests are kept in shared memory.");
+  
+  string taskId = tester.submit_to_suite("file_file.c", suiteHash);
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  ptree taskResult = wait_for_final_status(taskId);
+  BOOST_CHECK_EQUAL(taskResult.get<string>("STATE"), "FINISHED");
+  for (const auto& testName : { "TEST0", "TEST1", "TEST2", "TEST3" })
+    BOOST_CHECK_EQUAL(taskResult.get<string>(testName), "1");
+  tester.delete_task(taskId);
+  tester.delete_suite(suiteHash);
+}
+
+BOOST_AUTO_TEST_CASE( generated_tests )
+{
+  // Generator and reference solution run on grader (this machine), examples are installed to GENERATOR_DIR first
+  const grader::configuration& conf = grader::configuration::instance();
+  auto generatorDirIt = conf.get(grader::configuration::GENERATOR_DIR);
+  if (conf.invalid() == generatorDirIt || generatorDirIt->second.empty())
+  {
+    BOOST_TEST_MESSAGE("GENERATOR_DIR isn't configured, generated tests can't be graded.");
+    return;
+  }
+  namespace fs = boost::filesystem;
+  fs::create_directories(generatorDirIt->second);
+  for (const auto& program : { "numbers.sh", "sum.sh" })
+  {
+    fs::path installed = fs::path(generatorDirIt->second) / program;
+    fs::remove(installed);
+    fs::copy_file(fs::path(generators_dir) / program, installed);
+    fs::permissions(installed, fs::owner_all | fs::group_read | fs::group_exe | fs::others_read | fs::others_exe);
+  }
+  
+  // Suite isn't ready until worker that grades its first task produces tests
+  istringstream suiteStream(tester.upload_suite("generated.xml"));
+  ptree suiteResult;
+  json_parser::read_json(suiteStream, suiteResult);
+  string suiteHash = suiteResult.get<string>("SUITE");
+  BOOST_REQUIRE_EQUAL(suiteHash.size(), 40U);
+  BOOST_CHECK_NE(suiteResult.get<string>("STATE"), "INVALID");
+  
+  // First test has generated input and expected output of reference solution, second one generated input only
+  string taskId = tester.submit_to_suite("std_std.c", suiteHash);
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  ptree taskResult = wait_for_final_status(taskId);
+  BOOST_CHECK_EQUAL(taskResult.get<string>("STATE"), "FINISHED");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST0"), "1");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST1"), "1");
+  tester.delete_task(taskId);
+  tester.delete_suite(suiteHash);
+}
+
+BOOST_AUTO_TEST_CASE( cached_result )
+{
+  // First run is graded fresh (and refreshes cached result), second status is served from result cache
+  vector<ptree> statuses;
+  unsigned long hits = 0;
+  for (int i = 0; i < 2; ++i)
+  {
+    if (1 == i)
+      hits = stats_counter("RESULT_CACHE.HITS");
+    string taskId = tester.submit("std_std.c", "std_std.xml", 0 == i ? "nocache=1" : "");
+    BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+    statuses.push_back(wait_for_final_status(taskId));
+    BOOST_CHECK_EQUAL(statuses.back().get<string>("STATE"), "FINISHED");
+    tester.delete_task(taskId);
+  }
+  BOOST_CHECK(statuses[0] == statuses[1]);
+  BOOST_CHECK_GT(stats_counter("RESULT_CACHE.HITS"), hits);
+}
+
+BOOST_AUTO_TEST_CASE( coalesced_submissions )
+{
+  // Identical sources submitted together share one grading run, but every one gets its own id
+  // (result cache is bypassed, so run is really graded and second task follows it; other tests can add followers meanwhile)
+  auto followers = stats_counter("INFLIGHT.FOLLOWERS");
+  istringstream batchStream(tester.submit_batch({"std_std.c", "std_std.c"}, "std_std.xml", "nocache=1"));
+  ptree batchResult;
+  json_parser::read_json(batchStream, batchResult);
+  vector<string> taskIds;
+  for (const auto& id : batchResult)
+    taskIds.push_back(id.second.get_value<string>());
+  BOOST_REQUIRE_EQUAL(taskIds.size(), 2U);
+  BOOST_CHECK_NE(taskIds[0], taskIds[1]);
+  
+  vector<ptree> statuses;
+  for (const auto& taskId : taskIds)
+  {
+    statuses.push_back(wait_for_final_status(taskId));
+    BOOST_CHECK_EQUAL(statuses.back().get<string>("STATE"), "FINISHED");
+  }
+  BOOST_CHECK(statuses[0] == statuses[1]);
+  BOOST_CHECK_GE(stats_counter("INFLIGHT.FOLLOWERS"), followers + 1);
+  for (const auto& taskId : taskIds)
+    tester.delete_task(taskId);
+}
+
+BOOST_AUTO_TEST_CASE( streamed_events )
+{
+  // Graded run, run served from result cache and run shared by identical submission all stream test events
+  string gradedId = tester.submit("std_std.c", "std_std.xml", "nocache=1");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(gradedId.c_str()));
+  check_test_events(stream_events(gradedId), 3);
+  
+  auto hits = stats_counter("RESULT_CACHE.HITS");
+  string cachedId = tester.submit("std_std.c", "std_std.xml");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(cachedId.c_str()));
+  check_test_events(stream_events(cachedId), 3);
+  BOOST_CHECK_GT(stats_counter("RESULT_CACHE.HITS"), hits);
+  
+  istringstream batchStream(tester.submit_batch({"std_std.c", "std_std.c"}, "std_std.xml", "nocache=1"));
+  ptree batchResult;
+  json_parser::read_json(batchStream, batchResult);
+  vector<string> sharedIds;
+  for (const auto& id : batchResult)
+    sharedIds.push_back(id.second.get_value<string>());
+  BOOST_REQUIRE_EQUAL(sharedIds.size(), 2U);
+  check_test_events(stream_events(sharedIds[1]), 3);
+  check_test_events(stream_events(sharedIds[0]), 3);
+  
+  for (const auto& taskId : { gradedId, cachedId, sharedIds[0], sharedIds[1] })
+    tester.delete_task(taskId);
+}
+
+BOOST_AUTO_TEST_CASE( batch_status )
+{
+  // Statuses of finished, deleted and badly named tasks come in one JSON object keyed by id
+  string finishedId = tester.submit("std_std.c", "std_std.xml");
+  string deletedId = tester.submit("compiler_err.c", "compiler_err.xml");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(finishedId.c_str()));
+  BOOST_REQUIRE(grader::task::is_valid_task_name(deletedId.c_str()));
+  for (const auto& taskId : { finishedId, deletedId })
+    wait_for_final_status(taskId);
+  tester.delete_task(deletedId);
+  
+  istringstream statusesStream(tester.fetch_statuses({finishedId, deletedId, "not-a-task"}));
+  ptree statuses;
+  json_parser::read_json(statusesStream, statuses);
+  BOOST_REQUIRE_EQUAL(statuses.size(), 3U);
+  BOOST_CHECK_EQUAL(statuses.get_child(ptree::path_type(finishedId, '\0')).get<string>("STATE"), "FINISHED");
+  BOOST_CHECK_EQUAL(statuses.get_child(ptree::path_type(finishedId, '\0')).get<string>("TEST0"), "1");
+  BOOST_CHECK_EQUAL(statuses.get_child(ptree::path_type(deletedId, '\0')).get<string>("STATE"), "NOT_FOUND");
+  BOOST_CHECK_EQUAL(statuses.get_child(ptree::path_type("not-a-task", '\0')).get<string>("STATE"), "INVALID_TASK_NAME");
+  tester.delete_task(finishedId);
+}
+
+BOOST_AUTO_TEST_CASE( occupancy_stats )
+{
+  // Task that wasn't deleted yet is counted in task table
+  string taskId = tester.submit("std_std.c", "std_std.xml");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  istringstream statsStream(tester.fetch_status("stats"));
+  ptree stats;
+  json_parser::read_json(statsStream, stats);
+  BOOST_CHECK_GT(stats.get<size_t>("SEGMENT_SIZE"), stats.get<size_t>("SEGMENT_FREE"));
+  BOOST_CHECK_GE(stats.get<size_t>("TASKS"), 1U);
+  BOOST_CHECK_LE(stats.get<size_t>("TASKS"), stats.get<size_t>("MAX_TASKS"));
+  BOOST_CHECK_LE(stats.get<size_t>("QUEUED"), stats.get<size_t>("QUEUE_SIZE"));
+  BOOST_CHECK(stats.get_child_optional("INFLIGHT.FOLLOWERS"));
+  BOOST_CHECK(stats.get_child_optional("REAPER.EXPIRED"));
+  BOOST_CHECK(stats.get_child_optional("REAPER.ORPHANED"));
+  BOOST_CHECK(stats.get_child_optional("COMPILE_CACHE.HITS"));
+  BOOST_CHECK(stats.get_child_optional("RESULT_CACHE.HITS"));
+  tester.delete_task(taskId);
+}
+
 BOOST_AUTO_TEST_CASE( compiler_err )
 {
     // Submit task and check that we got valid task id
   string taskId = tester.submit("compiler_err.c", "compiler_err.xml");
   BOOST_CHECK(grader::task::is_valid_task_name(taskId.c_str()));
   
-  // Pool for finished task
+  // Poll for finished task
   ptree taskResult;
   do {
-    // Wait a little
-    this_thread::sleep_for(chrono::milliseconds(300));
-    
-    // Get task status
-    string body = tester.fetch_status(taskId);
+    // Get task status (server answers as soon as task state changes)
+    string body = tester.fetch_status(taskId, LONG_POLL_MS);
     istringstream taskStatusStream(body);
     json_parser::read_json(taskStatusStream, taskResult);
     string taskState = taskResult.get<string>("STATE");
@@ -162,4 +514,31 @@ BOOST_AUTO_TEST_CASE( compiler_err )
   BOOST_CHECK(true);
 }
 
+BOOST_AUTO_TEST_CASE( early_kill )
+{
+  // Program that writes wrong answer and sleeps fails at once instead of running into time limit
+  string taskId = tester.submit("early_kill.c", "early_kill.xml", "nocache=1");
+  BOOST_REQUIRE(grader::task::is_valid_task_name(taskId.c_str()));
+  ptree taskResult = wait_for_final_status(taskId);
+  BOOST_CHECK_EQUAL(taskResult.get<string>("STATE"), "FINISHED");
+  BOOST_CHECK_EQUAL(taskResult.get<string>("TEST0"), "0");
+  BOOST_CHECK_LT(taskResult.get<size_t>("METRICS.TEST0.WALL_MS"), 4000U);
+  tester.delete_task(taskId);
+}
+
+BOOST_AUTO_TEST_CASE( time_limit )
+{
+  // Busy program breaks CPU time limit, sleeping one only wall time limit
+  test_single_verdict("tle_busy", "TLE");
+  test_single_verdict("tle_sleep", "TLE");
+}
+
+BOOST_AUTO_TEST_CASE( memory_limit )
+{
+  // Without cgroup program is only refused memory, its crash near address space limit is still MLE,
+  // while crash far below limit is failed test
+  test_single_verdict("mle_malloc", "MLE");
+  test_single_verdict("crash_small", "0");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file